@@ -0,0 +1,101 @@
+#include "../mnemosyne.h"
+
+#include <cstdio>
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+const size_t haystack_size = 256 * 1024 * 1024;
+const char* const pattern = "48 8b 05 ?? ?? ?? ?? 48 85 c0 74 ?? e8 3c 7f";
+
+// the byte at a time loop pattern_match used before the scan engines
+uintptr_t find_address_bytewise(const std::vector<uint8_t>& bytearray,
+                                const std::vector<uint8_t>& mask,
+                                uintptr_t memory_start,
+                                size_t memory_size) {
+  for (uintptr_t current = memory_start;
+       current + bytearray.size() <= memory_start + memory_size; ++current) {
+    size_t j = 0;
+    for (j = 0; j < bytearray.size() &&
+                (mask.at(j) == 0x01 ||
+                 !(*reinterpret_cast<uint8_t*>(current + j) ^ bytearray.at(j)));
+         ++j)
+      ;
+
+    if (j == bytearray.size()) {
+      return current;
+    }
+  }
+
+  return 0;
+}
+
+template <typename F>
+void report(const char* name, F scan) {
+  auto start = std::chrono::steady_clock::now();
+  uintptr_t found = scan();
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+
+  printf("%-10s %8.3f GB/s  (%p)\n", name,
+         haystack_size / elapsed.count() / 1e9,
+         reinterpret_cast<void*>(found));
+}
+}  // namespace
+
+int main() {
+  // code-like filler: lots of common opcode bytes, match planted at the end
+  std::vector<uint8_t> haystack(haystack_size);
+  std::mt19937 mt(42);
+  const uint8_t filler[] = {0x00, 0xff, 0x48, 0x8b, 0x89, 0xcc, 0x0f, 0x24,
+                            0xe8, 0x85, 0x74, 0xc3, 0x90, 0x05, 0xc0, 0x3c};
+  std::uniform_int_distribution<int32_t> dist(0, 255);
+  for (auto& byte : haystack) {
+    int32_t n = dist(mt);
+    byte = n < 192 ? filler[n % sizeof(filler)] : static_cast<uint8_t>(n);
+  }
+
+  std::vector<uint8_t> needle =
+      mnemosyne::util::string_to_bytes("48 8b 05 11 22 33 44 48 85 c0 74 10 "
+                                       "e8 3c 7f");
+  std::copy(needle.begin(), needle.end(), haystack.end() - needle.size());
+
+  std::vector<uint8_t> bytearray = needle;
+  std::vector<uint8_t> mask(needle.size(), 0);
+  for (size_t n : {3, 4, 5, 6, 11}) {
+    bytearray.at(n) = 0;
+    mask.at(n) = 1;
+  }
+
+  report("bytewise", [&]() {
+    return find_address_bytewise(bytearray, mask,
+                                 reinterpret_cast<uintptr_t>(haystack.data()),
+                                 haystack.size());
+  });
+
+  const std::pair<const char*, mnemosyne::pattern_match::scan_engine>
+      engines[] = {{"scalar", mnemosyne::pattern_match::scan_engine::scalar},
+                   {"sse2", mnemosyne::pattern_match::scan_engine::sse2},
+                   {"avx2", mnemosyne::pattern_match::scan_engine::avx2}};
+
+  for (const auto& engine : engines) {
+    if (engine.second > mnemosyne::pattern_match::best_engine()) {
+      continue;
+    }
+
+    mnemosyne::pattern_match match(pattern, haystack.data(), haystack.size());
+    match.use_engine(engine.second);
+    report(engine.first, [&]() { return match.find_address(); });
+  }
+
+  mnemosyne::pattern_match match(pattern, haystack.data(), haystack.size());
+  report("parallel", [&]() { return match.find_address_parallel(); });
+
+  return 0;
+}
@@ -1,9 +1,61 @@
 #include "mnemosyne.h"
 
+#include <atomic>
+#include <cctype>
+#include <cinttypes>
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
 #include <iomanip>
+#include <iterator>
+#include <mutex>
 #include <sstream>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+
+#ifdef _WIN32
+#include <psapi.h>
+#include <tlhelp32.h>
 
 #include "detours.h"
+#else
+#include <dirent.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <link.h>
+#include <linux/membarrier.h>
+#include <setjmp.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <ucontext.h>
+#include <unistd.h>
+#endif
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || \
+    defined(__i386__)
+#define MNEMOSYNE_X86
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#include <immintrin.h>
+#endif
+
+#if defined(MNEMOSYNE_X86) && defined(__GNUC__)
+#define MNEMOSYNE_TARGET_SSE2 __attribute__((target("sse2")))
+#define MNEMOSYNE_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define MNEMOSYNE_TARGET_SSE2
+#define MNEMOSYNE_TARGET_AVX2
+#endif
 
 #ifdef _WIN64
 #pragma comment(lib, "detours64.lib")
@@ -11,309 +63,6856 @@
 #pragma comment(lib, "detours.lib")
 #endif
 
-mnemosyne::address::address() {
-  this->with_page_execute_read_write =
-      [this](size_t size, const std::function<bool(void)>& callback) {
-        std::function<bool()> has_page_read_write_access = [this]() -> bool {
-          MEMORY_BASIC_INFORMATION mbi = {0};
+#ifdef _WIN32
+#pragma comment(lib, "psapi.lib")
+#endif
 
-          if (VirtualQuery(this->ptr, &mbi, sizeof(MEMORY_BASIC_INFORMATION)) !=
-              sizeof(MEMORY_BASIC_INFORMATION)) {
-            return false;
-          }
+namespace {
+// pattern bytes as seen by the scan engines
+struct scan_pattern {
+  const uint8_t* bytes;
+  const uint8_t* mask;
+  size_t size;
+  size_t anchor;
+  size_t second_anchor;
+};
 
-          if (!mbi.Protect || (mbi.Protect & PAGE_GUARD)) {
-            return false;
-          }
+// appends the bytes and mask of the pattern, returns the number of bytes or
+// 0 if the pattern is malformed
+size_t parse_pattern(const std::string& pattern,
+                     std::vector<uint8_t>& bytearray,
+                     std::vector<uint8_t>& mask) {
+  size_t offset = bytearray.size();
+  bytearray.resize(offset + pattern.size() / 2);
+  mask.resize(offset + pattern.size() / 2);
 
-          if (!(mbi.Protect & PAGE_EXECUTE_READWRITE)) {
-            return false;
-          }
+  size_t pattern_size =
+      mnemosyne::util::parse_pattern(pattern.data(), pattern.size(),
+                                     bytearray.data() + offset,
+                                     mask.data() + offset);
 
-          return true;
-        };
+  bytearray.resize(offset + pattern_size);
+  mask.resize(offset + pattern_size);
+  return pattern_size;
+}
 
-        if (!has_page_read_write_access()) {
-          DWORD protect = 0;
-          VirtualProtect(this->ptr, size, PAGE_EXECUTE_READWRITE, &protect);
-        }
+// how common a byte is in x86 code and data, 0 for everything not listed.
+// anchoring on rare bytes keeps the number of candidates to verify low
+uint8_t byte_frequency(uint8_t byte) {
+  static const uint8_t common[] = {
+      0x00, 0xff, 0x48, 0x8b, 0x89, 0xcc, 0x01, 0x0f, 0x24, 0x44, 0x4c,
+      0xe8, 0x83, 0x85, 0x74, 0x75, 0xc3, 0x90, 0x20, 0x10, 0x08, 0x04,
+      0x40, 0xc0, 0x8d, 0x45, 0x02, 0x03, 0x18, 0x28, 0x30, 0x38, 0x49,
+      0x41, 0xeb, 0xe9, 0x33, 0xc7, 0x5c, 0x4d, 0x80, 0x50, 0x54, 0x65};
 
-        return callback();
-      };
+  for (size_t n = 0; n < sizeof(common); ++n) {
+    if (common[n] == byte) {
+      return static_cast<uint8_t>(sizeof(common) - n);
+    }
+  }
 
-  HANDLE process = GetCurrentProcess();
-  HANDLE token = 0;
-  if (OpenProcessToken(process, TOKEN_ADJUST_PRIVILEGES, &token)) {
-    CloseHandle(token);
-    CloseHandle(process);
-    return;
+  return 0;
+}
+
+// picks the rarest non-wildcard byte, then the rarest one at another offset,
+// preferring the pair that lies furthest apart. false if every byte is a
+// wildcard, there is nothing to anchor on
+bool select_anchors(const uint8_t* bytes,
+                    const uint8_t* mask,
+                    size_t size,
+                    size_t& anchor,
+                    size_t& second_anchor) {
+  // starts on a literal, a wildcard's placeholder byte must never be compared
+  anchor = std::find_if(mask, mask + size, [](uint8_t m) { return m; }) - mask;
+  if (anchor == size) {
+    anchor = 0;
+    second_anchor = 0;
+    return false;
   }
 
-  LUID luid = {0};
-  if (!LookupPrivilegeValueA(0, "SeDebugPrivilege", &luid)) {
-    CloseHandle(token);
-    CloseHandle(process);
-    return;
+  second_anchor = anchor;
+
+  for (size_t n = 0; n < size; ++n) {
+    if (mask[n] && byte_frequency(bytes[n]) < byte_frequency(bytes[anchor])) {
+      anchor = n;
+    }
   }
 
-  TOKEN_PRIVILEGES privileges = {0};
-  privileges.PrivilegeCount = 1;
-  privileges.Privileges[0].Luid = luid;
-  privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+  bool found = false;
+  size_t best_distance = 0;
+  for (size_t n = 0; n < size; ++n) {
+    if (!mask[n] || n == anchor) {
+      continue;
+    }
 
-  AdjustTokenPrivileges(token, false, &privileges, 0, 0, 0);
+    size_t distance = n > anchor ? n - anchor : anchor - n;
+    if (!found ||
+        byte_frequency(bytes[n]) < byte_frequency(bytes[second_anchor]) ||
+        (byte_frequency(bytes[n]) == byte_frequency(bytes[second_anchor]) &&
+         distance > best_distance)) {
+      second_anchor = n;
+      best_distance = distance;
+      found = true;
+    }
+  }
 
-  CloseHandle(token);
-  CloseHandle(process);
+  return true;
 }
 
-mnemosyne::address::address(void* ptr) : address::address() {
-  this->ptr = ptr;
-}
+// candidates per unit of work for the parallel scans
+const size_t scan_chunk_size = 1 << 20;
 
-mnemosyne::address::address(uintptr_t intptr) : address::address() {
-  this->ptr = reinterpret_cast<void*>(intptr);
-}
+// hands chunks out in increasing order to whichever thread is idle, the
+// calling thread takes part. threads are per call rather than a static pool
+// so nothing has to be joined while the loader lock is held on unload
+void for_each_chunk(size_t chunks,
+                    size_t threads,
+                    const std::function<void(size_t)>& work) {
+  if (!threads) {
+    threads = std::max(1u, std::thread::hardware_concurrency());
+  }
 
-void* mnemosyne::address::as_ptr() {
-  return this->ptr;
-}
+  threads = std::min(threads, chunks);
 
-uintptr_t mnemosyne::address::as_int() {
-  return reinterpret_cast<uintptr_t>(this->ptr);
+  std::atomic<size_t> next(0);
+  auto worker = [&]() {
+    for (size_t chunk = next++; chunk < chunks; chunk = next++) {
+      work(chunk);
+    }
+  };
+
+  std::vector<std::thread> pool;
+  for (size_t n = 1; n < threads; ++n) {
+    pool.emplace_back(worker);
+  }
+
+  worker();
+
+  for (auto& thread : pool) {
+    thread.join();
+  }
 }
 
-const std::vector<uint8_t> mnemosyne::address::read_memory(size_t size) {
-  std::vector<uint8_t> memory;
-  memory.reserve(size);
+// candidate ranges of at most scan_chunk_size, in address order. reads of
+// a chunk overlap the next one by pattern_size - 1
+std::vector<std::pair<uintptr_t, uintptr_t>> split_into_chunks(
+    const std::vector<mnemosyne::memory_region>& regions,
+    size_t pattern_size) {
+  std::vector<std::pair<uintptr_t, uintptr_t>> chunks;
 
-  this->with_page_execute_read_write(size, [&]() {
-    for (size_t i = 0; i < size; ++i) {
-      memory.push_back(*reinterpret_cast<uint8_t*>(this->as_int() + i));
+  for (const auto& region : regions) {
+    if (!pattern_size || region.size < pattern_size) {
+      continue;
     }
 
-    return true;
-  });
+    uintptr_t last = region.start + region.size - pattern_size;
+    for (uintptr_t first = region.start; first <= last;
+         first += scan_chunk_size) {
+      chunks.emplace_back(first,
+                          std::min(last, first + (scan_chunk_size - 1)));
 
-  return memory;
+      if (last - first < scan_chunk_size) {
+        break;
+      }
+    }
+  }
+
+  return chunks;
 }
 
-bool mnemosyne::address::write_memory(const std::vector<uint8_t>& bytes) {
-  return this->with_page_execute_read_write(bytes.size(), [&]() {
-    for (size_t i = 0; i < bytes.size(); ++i) {
-      *reinterpret_cast<uint8_t*>(this->as_int() + i) = bytes.at(i);
+// starts of values of size bytes that overlap a dirty range, sorted, joined
+// and clipped to [first, end)
+std::vector<mnemosyne::snapshot::range> overlapping_starts(
+    std::vector<mnemosyne::snapshot::range> dirty,
+    size_t size,
+    uintptr_t first,
+    uintptr_t end) {
+  std::sort(dirty.begin(), dirty.end(),
+            [](const mnemosyne::snapshot::range& a,
+               const mnemosyne::snapshot::range& b) {
+              return a.start < b.start;
+            });
+
+  std::vector<mnemosyne::snapshot::range> starts;
+  for (const auto& range : dirty) {
+    uintptr_t low = std::max(
+        first, range.start - std::min<uintptr_t>(range.start, size - 1));
+    uintptr_t high = std::min(end, range.start + range.size);
+    if (!size || low >= high) {
+      continue;
     }
 
-    return true;
-  });
+    if (!starts.empty() && low <= starts.back().start + starts.back().size) {
+      starts.back().size =
+          std::max(high, starts.back().start + starts.back().size) -
+          starts.back().start;
+    } else {
+      starts.push_back({low, high - low});
+    }
+  }
+
+  return starts;
 }
 
-bool mnemosyne::address::copy_memory(void* bytes, size_t size) {
-  return this->with_page_execute_read_write(size, [this, bytes, size]() {
-    return memcpy(this->ptr, bytes, size) != nullptr;
-  });
+// whether [start, start + size) overlaps any of the sorted disjoint ranges
+bool overlaps_ranges(const std::vector<mnemosyne::snapshot::range>& ranges,
+                     uintptr_t start,
+                     size_t size) {
+  auto it = std::upper_bound(
+      ranges.begin(), ranges.end(), start,
+      [](uintptr_t a, const mnemosyne::snapshot::range& r) {
+        return a < r.start + r.size;
+      });
+
+  return it != ranges.end() && it->start < start + size;
 }
 
-bool mnemosyne::address::fill_memory(uint8_t byte, size_t size) {
-  return this->with_page_execute_read_write(size, [this, byte, size]() {
-    return memset(this->ptr, byte, size) != nullptr;
-  });
+// parts of regions holding every value of size bytes that starts in starts
+std::vector<mnemosyne::memory_region> regions_of_starts(
+    const std::vector<mnemosyne::memory_region>& regions,
+    const std::vector<mnemosyne::snapshot::range>& starts,
+    size_t size) {
+  std::vector<mnemosyne::memory_region> parts;
+
+  for (const auto& range : starts) {
+    uintptr_t low = range.start;
+    uintptr_t high = range.start + range.size + (size - 1);
+
+    for (const auto& region : regions) {
+      uintptr_t first = std::max(low, region.start);
+      uintptr_t last = std::min(high, region.start + region.size);
+
+      if (first < last) {
+        mnemosyne::memory_region part = region;
+        part.start = first;
+        part.size = last - first;
+        parts.push_back(part);
+      }
+    }
+  }
+
+  return parts;
 }
 
-mnemosyne::memory_patch::memory_patch(const address& ptr,
-                                      const std::vector<uint8_t>& bytes)
-    : ptr(ptr), replace_bytes(bytes) {
-  this->retain_bytes = this->ptr.read_memory(bytes.size());
+// chunk of another process copied by pattern_match::scan_range, reused
+// while the scan that copied it continues into it
+struct copied_chunk {
+  uint64_t generation;
+  uintptr_t start;
+  std::vector<uint8_t> bytes;
+};
+
+// hands every refresh of pattern_match::regions a distinct generation
+std::atomic<uint64_t> scan_generation(0);
+thread_local copied_chunk copied = {0, 0, {}};
+
+void store_min(std::atomic<size_t>& target, size_t value) {
+  size_t current = target.load();
+  while (value < current && !target.compare_exchange_weak(current, value))
+    ;
 }
 
-bool mnemosyne::memory_patch::edit() {
-  return this->ptr.write_memory(this->replace_bytes);
+inline uint32_t count_trailing_zeros(uint32_t bits) {
+#ifdef _MSC_VER
+  unsigned long index = 0;
+  _BitScanForward(&index, bits);
+  return index;
+#else
+  return __builtin_ctz(bits);
+#endif
 }
 
-bool mnemosyne::memory_patch::revert() {
-  return this->ptr.write_memory(this->retain_bytes);
+// index of the highest set bit, bits must not be 0
+inline uint32_t highest_bit(uint64_t bits) {
+#if defined(_MSC_VER) && defined(_WIN64)
+  unsigned long index = 0;
+  _BitScanReverse64(&index, bits);
+  return index;
+#elif defined(_MSC_VER)
+  unsigned long index = 0;
+  if (_BitScanReverse(&index, static_cast<uint32_t>(bits >> 32))) {
+    return index + 32;
+  }
+
+  _BitScanReverse(&index, static_cast<uint32_t>(bits));
+  return index;
+#else
+  return 63 - __builtin_clzll(bits);
+#endif
 }
 
-mnemosyne::memory_patch::memory_patch() {}
+inline bool verify_from(const scan_pattern& p, const uint8_t* at, size_t j) {
+  for (; j + sizeof(uint64_t) <= p.size; j += sizeof(uint64_t)) {
+    uint64_t memory = 0, bytes = 0, mask = 0;
+    memcpy(&memory, at + j, sizeof(uint64_t));
+    memcpy(&bytes, p.bytes + j, sizeof(uint64_t));
+    memcpy(&mask, p.mask + j, sizeof(uint64_t));
 
-mnemosyne::memory_redirect::memory_redirect(void** ptr, void* to)
-    : ptr(ptr), to(to) {
-  this->detours = [](void** ptr, void* to, bool enable) -> bool {
-    if (DetourTransactionBegin() != NO_ERROR) {
+    if ((memory ^ bytes) & mask) {
       return false;
     }
+  }
 
-    if (DetourUpdateThread(GetCurrentThread()) != NO_ERROR) {
-      DetourTransactionAbort();
+  for (; j < p.size; ++j) {
+    if ((at[j] ^ p.bytes[j]) & p.mask[j]) {
       return false;
     }
+  }
 
-    if ((enable ? DetourAttach : DetourDetach)(ptr, to) != NO_ERROR) {
-      DetourTransactionAbort();
-      return false;
+  return true;
+}
+
+// candidates are [first, last], every candidate has p.size readable bytes
+uintptr_t scan_scalar(const scan_pattern& p, uintptr_t first, uintptr_t last) {
+  const uint8_t anchor = p.bytes[p.anchor];
+
+  for (uintptr_t candidate = first; candidate <= last; ++candidate) {
+    const uint8_t* at = reinterpret_cast<const uint8_t*>(candidate);
+
+    if (at[p.anchor] == anchor && verify_from(p, at, 0)) {
+      return candidate;
     }
+  }
 
-    return DetourTransactionCommit() == NO_ERROR;
-  };
+  return 0;
 }
 
-bool mnemosyne::memory_redirect::edit() {
-  return this->detours(this->ptr, this->to, true);
-}
+#ifdef MNEMOSYNE_X86
+MNEMOSYNE_TARGET_SSE2 inline bool verify_sse2(const scan_pattern& p,
+                                              const uint8_t* at) {
+  size_t j = 0;
+  for (; j + sizeof(__m128i) <= p.size; j += sizeof(__m128i)) {
+    __m128i diff = _mm_xor_si128(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(at + j)),
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(p.bytes + j)));
+    diff = _mm_and_si128(
+        diff, _mm_loadu_si128(reinterpret_cast<const __m128i*>(p.mask + j)));
 
-bool mnemosyne::memory_redirect::revert() {
-  return this->detours(this->ptr, this->to, false);
+    if (_mm_movemask_epi8(_mm_cmpeq_epi8(diff, _mm_setzero_si128())) !=
+        0xffff) {
+      return false;
+    }
+  }
+
+  return verify_from(p, at, j);
 }
 
-mnemosyne::memory_redirect::memory_redirect() {}
+MNEMOSYNE_TARGET_SSE2 uintptr_t scan_sse2(const scan_pattern& p,
+                                          uintptr_t first,
+                                          uintptr_t last) {
+  const __m128i anchor = _mm_set1_epi8(static_cast<char>(p.bytes[p.anchor]));
+  const __m128i second_anchor =
+      _mm_set1_epi8(static_cast<char>(p.bytes[p.second_anchor]));
 
-const std::string mnemosyne::util::byte_to_string(
-    const std::vector<uint8_t>& bytes,
-    const std::string& separator) {
-  std::stringstream ss;
+  uintptr_t candidate = first;
+  for (; candidate <= last && last - candidate >= sizeof(__m128i) - 1;
+       candidate += sizeof(__m128i)) {
+    __m128i hits = _mm_and_si128(
+        _mm_cmpeq_epi8(anchor, _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                                   candidate + p.anchor))),
+        _mm_cmpeq_epi8(second_anchor,
+                       _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+                           candidate + p.second_anchor))));
 
-  for (size_t n = 0; n < bytes.size(); ++n) {
-    if (!separator.compare("\\x")) {
-      ss << separator << std::uppercase << std::hex << std::setw(2)
-         << std::setfill('0') << static_cast<int32_t>(bytes.at(n));
-    } else {
-      ss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
-         << static_cast<int32_t>(bytes.at(n));
+    for (uint32_t bits = _mm_movemask_epi8(hits); bits; bits &= bits - 1) {
+      uintptr_t at = candidate + count_trailing_zeros(bits);
 
-      if (bytes.size() - 1 != n) {
-        ss << separator;
+      if (verify_sse2(p, reinterpret_cast<const uint8_t*>(at))) {
+        return at;
       }
     }
   }
 
-  return ss.str();
+  return candidate <= last ? scan_scalar(p, candidate, last) : 0;
 }
 
-const std::vector<uint8_t> mnemosyne::util::string_to_bytes(
-    std::string byte_string) {
-  std::vector<uint8_t> bytes;
+MNEMOSYNE_TARGET_AVX2 inline bool verify_avx2(const scan_pattern& p,
+                                              const uint8_t* at) {
+  size_t j = 0;
+  for (; j + sizeof(__m256i) <= p.size; j += sizeof(__m256i)) {
+    __m256i diff = _mm256_xor_si256(
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(at + j)),
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p.bytes + j)));
+    diff = _mm256_and_si256(
+        diff, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p.mask + j)));
 
-  byte_string.erase(std::remove(byte_string.begin(), byte_string.end(), ' '),
-                    byte_string.end());
-  if (byte_string.empty() || byte_string.size() % 2) {
-    return bytes;
+    if (!_mm256_testz_si256(diff, diff)) {
+      return false;
+    }
   }
 
-  bytes.reserve(byte_string.size() / 2);
+  return verify_from(p, at, j);
+}
 
-  std::mt19937 mt(static_cast<uint32_t>(
-      std::chrono::system_clock::now().time_since_epoch().count()));
-  std::uniform_int_distribution<int16_t> dist(0, 15);
-  std::stringstream ss;
+MNEMOSYNE_TARGET_AVX2 uintptr_t scan_avx2(const scan_pattern& p,
+                                          uintptr_t first,
+                                          uintptr_t last) {
+  const __m256i anchor =
+      _mm256_set1_epi8(static_cast<char>(p.bytes[p.anchor]));
+  const __m256i second_anchor =
+      _mm256_set1_epi8(static_cast<char>(p.bytes[p.second_anchor]));
 
-  for (auto it = byte_string.begin(); it != byte_string.end(); ++it) {
-    if (!isxdigit(*it)) {
-      ss << std::hex << std::setw(1) << dist(mt);
-    } else {
-      ss << std::hex << std::setw(1) << *it;
-    }
+  uintptr_t candidate = first;
+  for (; candidate <= last && last - candidate >= sizeof(__m256i) - 1;
+       candidate += sizeof(__m256i)) {
+    __m256i hits = _mm256_and_si256(
+        _mm256_cmpeq_epi8(anchor,
+                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                              candidate + p.anchor))),
+        _mm256_cmpeq_epi8(second_anchor,
+                          _mm256_loadu_si256(reinterpret_cast<const __m256i*>(
+                              candidate + p.second_anchor))));
 
-    if (ss.str().size() == 2) {
-      bytes.push_back(std::stoi(ss.str(), nullptr, 16));
-      ss.str("");
+    for (uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(hits));
+         bits; bits &= bits - 1) {
+      uintptr_t at = candidate + count_trailing_zeros(bits);
+
+      if (verify_avx2(p, reinterpret_cast<const uint8_t*>(at))) {
+        return at;
+      }
     }
   }
 
-  return bytes;
+  return candidate <= last ? scan_sse2(p, candidate, last) : 0;
 }
 
-mnemosyne::pattern_match::pattern_match(const std::string& pattern,
-                                        void* memory_start,
-                                        size_t memory_size)
-    : pattern(pattern),
-      memory_start(reinterpret_cast<uintptr_t>(memory_start)),
-      memory_size(memory_size) {
-  // remove trailing whitespaces and ?
-  this->pattern.erase(
-      std::find_if(this->pattern.rbegin(), this->pattern.rend(),
-                   [](int32_t chr) { return chr != ' ' && chr != '?'; })
-          .base(),
-      this->pattern.end());
-
-  // remove whitespaces
-  this->pattern.erase(
-      std::remove(this->pattern.begin(), this->pattern.end(), ' '),
-      this->pattern.end());
-
-  if (this->pattern.empty() || this->pattern.size() % 2) {
-    return;
+bool cpu_supports_avx2() {
+#ifdef _MSC_VER
+  int32_t info[4] = {0};
+  __cpuid(info, 0);
+  if (info[0] < 7) {
+    return false;
   }
 
-  this->pattern_size = static_cast<size_t>(this->pattern.size() / 2);
-  this->bytearray.reserve(pattern_size);
-  this->mask.reserve(pattern_size);
+  // the os must save the ymm registers on context switches
+  __cpuid(info, 1);
+  if (!(info[2] & (1 << 27)) || !(info[2] & (1 << 28)) ||
+      (_xgetbv(0) & 0x06) != 0x06) {
+    return false;
+  }
 
-  std::stringstream ss;
-  for (size_t n = 0; n < this->pattern.size(); n += 2) {
-    if (this->pattern.at(n) == '?' && this->pattern.at(n + 1) == '?') {
-      this->mask.push_back(1);
-      this->bytearray.push_back(0);
-    } else {
-      this->mask.push_back(0);
+  __cpuidex(info, 7, 0);
+  return (info[1] & (1 << 5)) != 0;
+#else
+  return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+}  // namespace
 
-      ss.str("");
-      ss << std::hex << this->pattern.at(n) << this->pattern.at(n + 1);
-      this->bytearray.push_back(std::stoi(ss.str(), nullptr, 16));
-    }
+#ifdef _WIN32
+namespace {
+mnemosyne::memory_region region_from(const MEMORY_BASIC_INFORMATION& mbi) {
+  const DWORD readable = PAGE_READONLY | PAGE_READWRITE | PAGE_WRITECOPY |
+                         PAGE_EXECUTE_READ | PAGE_EXECUTE_READWRITE |
+                         PAGE_EXECUTE_WRITECOPY;
+  const DWORD writable = PAGE_READWRITE | PAGE_WRITECOPY |
+                         PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+  const DWORD executable = PAGE_EXECUTE | PAGE_EXECUTE_READ |
+                           PAGE_EXECUTE_READWRITE | PAGE_EXECUTE_WRITECOPY;
+
+  mnemosyne::memory_region region = {
+      reinterpret_cast<uintptr_t>(mbi.BaseAddress), mbi.RegionSize, false,
+      false, false};
+
+  if (mbi.State == MEM_COMMIT &&
+      !(mbi.Protect & (PAGE_NOACCESS | PAGE_GUARD))) {
+    region.readable = (mbi.Protect & readable) != 0;
+    region.writable = (mbi.Protect & writable) != 0;
+    region.executable = (mbi.Protect & executable) != 0;
   }
+
+  return region;
 }
+}  // namespace
 
-uintptr_t mnemosyne::pattern_match::find_address() {
-  uintptr_t memory_end = this->memory_start + this->memory_size;
+size_t mnemosyne::platform::page_size() {
+  static const size_t size = []() {
+    SYSTEM_INFO info = {0};
+    GetSystemInfo(&info);
+    return static_cast<size_t>(info.dwPageSize);
+  }();
 
-  __try {
-    for (this->current_address = this->memory_start;
-         this->current_address < memory_end; ++this->current_address) {
-      if (this->try_match_at_current_address()) {
-        return this->current_address;
-      }
-    }
+  return size;
+}
+
+bool mnemosyne::platform::query(uintptr_t address, memory_region& region) {
+  MEMORY_BASIC_INFORMATION mbi = {0};
+
+  if (VirtualQuery(reinterpret_cast<void*>(address), &mbi,
+                   sizeof(MEMORY_BASIC_INFORMATION)) !=
+          sizeof(MEMORY_BASIC_INFORMATION) ||
+      mbi.State != MEM_COMMIT) {
+    return false;
   }
 
-  __except (EXCEPTION_EXECUTE_HANDLER) {
-    return 0;
+  region = region_from(mbi);
+  return true;
+}
+
+namespace {
+uint32_t native_protection(bool readable, bool writable, bool executable) {
+  if (executable) {
+    return writable   ? PAGE_EXECUTE_READWRITE
+           : readable ? PAGE_EXECUTE_READ
+                      : PAGE_EXECUTE;
   }
 
-  return 0;
+  return readable ? (writable ? PAGE_READWRITE : PAGE_READONLY) : PAGE_NOACCESS;
 }
 
-uintptr_t mnemosyne::pattern_match::find_next_address() {
-  uintptr_t memory_end = this->memory_start + this->memory_size;
+bool change_protection(uintptr_t address,
+                       size_t size,
+                       uint32_t protection,
+                       uint32_t& old) {
+  DWORD previous = 0;
+
+  if (!VirtualProtect(reinterpret_cast<void*>(address), size, protection,
+                      &previous)) {
+    return false;
+  }
+
+  old = previous;
+  return true;
+}
+}  // namespace
 
+bool mnemosyne::platform::guarded(const std::function<void(void)>& callback) {
   __try {
-    for (this->current_address = this->current_address + 1;
-         this->current_address < memory_end; ++this->current_address) {
-      if (this->try_match_at_current_address()) {
-        return this->current_address;
-      }
-    }
+    callback();
+    return true;
+  } __except (EXCEPTION_EXECUTE_HANDLER) {
+    return false;
   }
+}
 
-  __except (EXCEPTION_EXECUTE_HANDLER) {
-    return 0;
+bool mnemosyne::platform::read(void* destination,
+                               const void* source,
+                               size_t size) {
+  __try {
+    memcpy(destination, source, size);
+    return true;
+  } __except (EXCEPTION_EXECUTE_HANDLER) {
+    return false;
+  }
+}
+
+bool mnemosyne::platform::write(void* destination,
+                                const void* source,
+                                size_t size) {
+  __try {
+    memcpy(destination, source, size);
+    return true;
+  } __except (EXCEPTION_EXECUTE_HANDLER) {
+    return false;
   }
+}
+#else
+namespace {
+// every mapping of the process in address order, or of the process whose
+// maps file is at path
+std::vector<mnemosyne::memory_region> parse_maps(
+    const std::string& path = "/proc/self/maps") {
+  std::vector<mnemosyne::memory_region> maps;
+  std::ifstream file(path);
 
-  return 0;
+  for (std::string line; std::getline(file, line);) {
+    uintptr_t low = 0, high = 0;
+    char permissions[5] = {0};
+
+    if (sscanf(line.c_str(), "%" SCNxPTR "-%" SCNxPTR " %4s", &low, &high,
+               permissions) != 3) {
+      continue;
+    }
+
+    // the vvar page can fault on read even though it is mapped readable
+    if (line.find("[vvar]") != std::string::npos) {
+      continue;
+    }
+
+    maps.push_back({low, high - low, permissions[0] == 'r',
+                    permissions[1] == 'w', permissions[2] == 'x'});
+  }
+
+  return maps;
 }
 
-mnemosyne::pattern_match::pattern_match() {}
+std::mutex maps_mutex;
+std::vector<mnemosyne::memory_region> maps_cache;
 
-inline bool mnemosyne::pattern_match::try_match_at_current_address() {
-  size_t j = 0;
+// innermost guarded() or guarded copy of this thread, null when unguarded
+thread_local sigjmp_buf* fault_target = nullptr;
+struct sigaction previous_segv_action;
+struct sigaction previous_bus_action;
 
-  for (j = 0;
-       j < this->pattern_size &&
-       // continue if mask at is ?? or byte at address matches bytearray at
-       (this->mask.at(j) == 0x01 ||
-        !(*reinterpret_cast<uint8_t*>(this->current_address + j) ^
-          this->bytearray.at(j)));
-       ++j)
-    ;
+bool on_watch_fault(uintptr_t address, uintptr_t instruction, bool& step);
+bool on_watch_step();
+
+#ifdef __x86_64__
+#define MNEMOSYNE_INLINE_HOOK
+
+// moves a thread that hit the int3 of a hook being written
+bool on_patch_trap(siginfo_t* info, void* context);
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MNEMOSYNE_SINGLE_STEP
+
+uintptr_t instruction_pointer(void* context) {
+  auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext.gregs;
+#ifdef __x86_64__
+  return static_cast<uintptr_t>(registers[REG_RIP]);
+#else
+  return static_cast<uintptr_t>(registers[REG_EIP]);
+#endif
+}
+
+void set_instruction_pointer(void* context, uintptr_t instruction) {
+  auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext.gregs;
+#ifdef __x86_64__
+  registers[REG_RIP] = static_cast<greg_t>(instruction);
+#else
+  registers[REG_EIP] = static_cast<greg_t>(instruction);
+#endif
+}
+
+void set_trap_flag(void* context, bool enable) {
+  constexpr greg_t trap_flag = 0x100;
+  auto& registers = static_cast<ucontext_t*>(context)->uc_mcontext.gregs;
+
+  registers[REG_EFL] =
+      enable ? registers[REG_EFL] | trap_flag : registers[REG_EFL] & ~trap_flag;
+}
+#endif
+
+struct sigaction previous_trap_action;
+
+// runs the handler that was installed before ours
+void chain_signal(struct sigaction& previous,
+                  int32_t signal,
+                  siginfo_t* info,
+                  void* context) {
+  if (previous.sa_flags & SA_SIGINFO) {
+    previous.sa_sigaction(signal, info, context);
+  } else if (previous.sa_handler != SIG_DFL &&
+             previous.sa_handler != SIG_IGN) {
+    previous.sa_handler(signal);
+  } else {
+    // the faulting access runs again and gets the default action
+    sigaction(signal, &previous, nullptr);
+  }
+}
+
+void on_fault(int32_t signal, siginfo_t* info, void* context) {
+#ifdef MNEMOSYNE_SINGLE_STEP
+  // pages of a write_watch are readable, an access fault on one is a write
+  bool step = false;
+  if (signal == SIGSEGV && info->si_code == SEGV_ACCERR &&
+      on_watch_fault(reinterpret_cast<uintptr_t>(info->si_addr),
+                     instruction_pointer(context), step)) {
+    if (step) {
+      set_trap_flag(context, true);
+    }
+
+    return;
+  }
+#endif
+
+  if (fault_target) {
+    siglongjmp(*fault_target, 1);
+  }
+
+  // not a guarded access, hand it to whoever handled it before us
+  chain_signal(signal == SIGSEGV ? previous_segv_action : previous_bus_action,
+               signal, info, context);
+}
+
+// the step after a watched write, or an int3 of a hook being written
+void on_trap(int32_t signal, siginfo_t* info, void* context) {
+#ifdef MNEMOSYNE_SINGLE_STEP
+  if (on_watch_step()) {
+    set_trap_flag(context, false);
+    return;
+  }
+#endif
+
+#ifdef MNEMOSYNE_INLINE_HOOK
+  if (on_patch_trap(info, context)) {
+    return;
+  }
+#endif
+
+  chain_signal(previous_trap_action, signal, info, context);
+}
+
+void install_fault_handler() {
+  static std::once_flag installed;
+
+  std::call_once(installed, []() {
+    // SA_NODEFER keeps the signal unblocked after siglongjmp leaves the
+    // handler, so sigsetjmp does not need to save the mask
+    struct sigaction action = {};
+    action.sa_sigaction = on_fault;
+    action.sa_flags = SA_SIGINFO | SA_NODEFER | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGSEGV, &action, &previous_segv_action);
+    sigaction(SIGBUS, &action, &previous_bus_action);
+  });
+}
+
+void install_trap_handler() {
+  static std::once_flag installed;
+
+  std::call_once(installed, []() {
+    struct sigaction action = {};
+    action.sa_sigaction = on_trap;
+    action.sa_flags = SA_SIGINFO | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGTRAP, &action, &previous_trap_action);
+  });
+}
+
+bool guarded_copy(void* destination, const void* source, size_t size) {
+  install_fault_handler();
+
+  sigjmp_buf target;
+  sigjmp_buf* outer = fault_target;
+
+  if (sigsetjmp(target, 0)) {
+    fault_target = outer;
+    return false;
+  }
+
+  fault_target = &target;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  memcpy(destination, source, size);
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  fault_target = outer;
+
+  return true;
+}
+}  // namespace
+
+size_t mnemosyne::platform::page_size() {
+  static const size_t size = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+  return size;
+}
+
+bool mnemosyne::platform::query(uintptr_t address, memory_region& region) {
+  std::lock_guard<std::mutex> lock(maps_mutex);
+
+  for (int32_t attempt = 0; attempt < 2; ++attempt) {
+    auto it = std::upper_bound(
+        maps_cache.begin(), maps_cache.end(), address,
+        [](uintptr_t a, const memory_region& r) { return a < r.start; });
+
+    if (it != maps_cache.begin() &&
+        address - (it - 1)->start < (it - 1)->size) {
+      region = *(it - 1);
+      return true;
+    }
+
+    // a miss may be a mapping created since the last parse
+    if (!attempt) {
+      maps_cache = parse_maps();
+    }
+  }
+
+  return false;
+}
+
+namespace {
+uint32_t native_protection(bool readable, bool writable, bool executable) {
+  return (readable ? PROT_READ : 0) | (writable ? PROT_WRITE : 0) |
+         (executable ? PROT_EXEC : 0);
+}
+
+bool change_protection(uintptr_t address,
+                       size_t size,
+                       uint32_t protection,
+                       uint32_t& old) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  const uintptr_t page_mask = ~static_cast<uintptr_t>(page_size - 1);
+  uintptr_t start = address & page_mask;
+  uintptr_t end =
+      (address + std::max<size_t>(size, 1) + page_size - 1) & page_mask;
+
+  // mprotect does not report the previous protection
+  mnemosyne::memory_region region = {0, 0, false, false, false};
+  mnemosyne::platform::query(start, region);
+  uint32_t previous = native_protection(region.readable, region.writable,
+                                        region.executable);
+
+  bool changed = mprotect(reinterpret_cast<void*>(start), end - start,
+                          static_cast<int32_t>(protection)) == 0;
+
+  std::lock_guard<std::mutex> lock(maps_mutex);
+  maps_cache.clear();
+
+  if (changed) {
+    old = previous;
+  }
+
+  return changed;
+}
+}  // namespace
+
+bool mnemosyne::platform::guarded(const std::function<void(void)>& callback) {
+  install_fault_handler();
+
+  sigjmp_buf target;
+  sigjmp_buf* outer = fault_target;
+
+  if (sigsetjmp(target, 0)) {
+    fault_target = outer;
+    return false;
+  }
+
+  fault_target = &target;
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  callback();
+  std::atomic_signal_fence(std::memory_order_seq_cst);
+  fault_target = outer;
+
+  return true;
+}
+
+bool mnemosyne::platform::read(void* destination,
+                               const void* source,
+                               size_t size) {
+  return guarded_copy(destination, source, size);
+}
+
+bool mnemosyne::platform::write(void* destination,
+                                const void* source,
+                                size_t size) {
+  return guarded_copy(destination, source, size);
+}
+#endif
+
+namespace {
+struct page_state {
+  bool readable;
+  bool writable;
+  bool executable;
+  // as the system reports it, with modifiers like PAGE_GUARD
+  uint32_t native;
+  // base of the windows allocation, one VirtualProtect can not span two
+  uintptr_t allocation;
+  // native protection to restore once no make_writable holds the page
+  uint32_t original;
+  uint32_t changes;
+};
+
+std::mutex protection_mutex;
+// keyed by page base
+std::unordered_map<uintptr_t, page_state> protection_cache;
+
+// first and last page base of [address, address + size)
+std::pair<uintptr_t, uintptr_t> page_span(void* address, size_t size) {
+  const uintptr_t page_mask =
+      ~static_cast<uintptr_t>(mnemosyne::platform::page_size() - 1);
+  uintptr_t start = reinterpret_cast<uintptr_t>(address);
+
+  return {start & page_mask,
+          (start + std::max<size_t>(size, 1) - 1) & page_mask};
+}
+
+// pages the system knows nothing about are treated as inaccessible
+page_state query_page(uintptr_t page) {
+#ifdef _WIN32
+  MEMORY_BASIC_INFORMATION mbi = {};
+  if (VirtualQuery(reinterpret_cast<void*>(page), &mbi, sizeof(mbi)) !=
+      sizeof(mbi)) {
+    return {false, false, false, PAGE_NOACCESS, 0, 0, 0};
+  }
+
+  mnemosyne::memory_region region = region_from(mbi);
+  return {region.readable,
+          region.writable,
+          region.executable,
+          mbi.Protect,
+          reinterpret_cast<uintptr_t>(mbi.AllocationBase),
+          0,
+          0};
+#else
+  mnemosyne::memory_region region = {0, 0, false, false, false};
+  mnemosyne::platform::query(page, region);
+
+  // mprotect spans mappings, every page counts as one allocation
+  return {region.readable,
+          region.writable,
+          region.executable,
+          native_protection(region.readable, region.writable,
+                            region.executable),
+          0,
+          0,
+          0};
+#endif
+}
+}  // namespace
+
+bool mnemosyne::platform::protect(void* address,
+                                  size_t size,
+                                  bool readable,
+                                  bool writable,
+                                  bool executable) {
+  uint32_t old = 0;
+  bool changed =
+      change_protection(reinterpret_cast<uintptr_t>(address), size,
+                        native_protection(readable, writable, executable), old);
+
+  invalidate(address, size);
+  return changed;
+}
+
+bool mnemosyne::platform::make_writable(void* address,
+                                        size_t size,
+                                        protection_change& change) {
+  change = {address, size, false};
+  bool writable = true;
+  auto span = page_span(address, size);
+
+  // pages to change are collected into runs of the same native protection
+  // and allocation and changed with one call per run
+  uintptr_t run_start = 0;
+  size_t run_pages = 0;
+  page_state run_state = {false, false, false, 0, 0, 0, 0};
+
+  auto flush = [&]() {
+    if (!run_pages) {
+      return;
+    }
+
+#ifdef _WIN32
+    bool executable = true;
+    // caching modifiers stay, PAGE_GUARD comes back with the original
+    uint32_t protection =
+        native_protection(true, true, executable) |
+        (run_state.native & (PAGE_NOCACHE | PAGE_WRITECOMBINE));
+#else
+    bool executable = run_state.executable;
+    uint32_t protection = native_protection(true, true, executable);
+#endif
+    uint32_t original = 0;
+
+    // every page of the run had the same protection, the one reported
+    if (change_protection(run_start, run_pages * page_size(), protection,
+                          original)) {
+      for (size_t n = 0; n < run_pages; ++n) {
+        protection_cache[run_start + n * page_size()] = {
+            true,     true, executable, protection, run_state.allocation,
+            original, 1};
+      }
+
+      change.changed = true;
+    } else {
+      writable = false;
+    }
+
+    run_pages = 0;
+  };
+
+  std::lock_guard<std::mutex> lock(protection_mutex);
+
+  for (uintptr_t page = span.first;; page += page_size()) {
+    auto it = protection_cache.find(page);
+
+    if (it == protection_cache.end()) {
+      it = protection_cache.emplace(page, query_page(page)).first;
+    }
+
+    page_state& state = it->second;
+    bool needs_change = !state.changes && (!state.readable || !state.writable);
+
+    if (run_pages &&
+        (!needs_change || state.native != run_state.native ||
+         state.allocation != run_state.allocation)) {
+      flush();
+    }
+
+    if (needs_change) {
+      if (!run_pages) {
+        run_start = page;
+        run_state = state;
+      }
+
+      ++run_pages;
+    } else if (state.changes) {
+      ++state.changes;
+      change.changed = true;
+    }
+
+    if (page == span.second) {
+      break;
+    }
+  }
+
+  flush();
+  return writable;
+}
+
+void mnemosyne::platform::restore(const protection_change& change) {
+  if (!change.changed) {
+    return;
+  }
+
+  auto span = page_span(change.address, change.size);
+
+  // pages released by their last holder, restored in runs of the same
+  // original protection and allocation
+  uintptr_t run_start = 0;
+  size_t run_pages = 0;
+  uint32_t run_original = 0;
+  uintptr_t run_allocation = 0;
+
+  auto flush = [&]() {
+    uint32_t old = 0;
+
+    // pages that cannot be put back stay cached as writable
+    if (run_pages && change_protection(run_start, run_pages * page_size(),
+                                       run_original, old)) {
+      for (size_t n = 0; n < run_pages; ++n) {
+        protection_cache.erase(run_start + n * page_size());
+      }
+    }
+
+    run_pages = 0;
+  };
+
+  std::lock_guard<std::mutex> lock(protection_mutex);
+
+  for (uintptr_t page = span.first;; page += page_size()) {
+    auto it = protection_cache.find(page);
+
+    if (it == protection_cache.end() || !it->second.changes ||
+        --it->second.changes) {
+      flush();
+    } else {
+      if (run_pages && (it->second.original != run_original ||
+                        it->second.allocation != run_allocation)) {
+        flush();
+      }
+
+      if (!run_pages) {
+        run_start = page;
+        run_original = it->second.original;
+        run_allocation = it->second.allocation;
+      }
+
+      ++run_pages;
+    }
+
+    if (page == span.second) {
+      break;
+    }
+  }
+
+  flush();
+}
+
+void mnemosyne::platform::invalidate(void* address, size_t size) {
+  auto span = page_span(address, size);
+
+  std::lock_guard<std::mutex> lock(protection_mutex);
+
+  for (uintptr_t page = span.first;; page += page_size()) {
+    auto it = protection_cache.find(page);
+
+    // pages held by a make_writable are restored by it
+    if (it != protection_cache.end() && !it->second.changes) {
+      protection_cache.erase(it);
+    }
+
+    if (page == span.second) {
+      break;
+    }
+  }
+}
+
+void mnemosyne::platform::invalidate() {
+  std::lock_guard<std::mutex> lock(protection_mutex);
+
+  for (auto it = protection_cache.begin(); it != protection_cache.end();) {
+    it = it->second.changes ? std::next(it) : protection_cache.erase(it);
+  }
+}
+
+#if defined(_WIN32) && defined(MNEMOSYNE_X86)
+#define MNEMOSYNE_SINGLE_STEP
+#endif
+
+namespace mnemosyne {
+// armed write watches, searched by the fault handlers without locks
+class watch_registry {
+ public:
+  static bool add(write_watch* watch);
+  static void remove(write_watch* watch);
+  // ends the disarm of a removed watch once its pages are restored
+  static void restored();
+
+  // makes the page of a watched write writable, false if no watch holds
+  // the page. step is set if the write has to be stepped over, not if the
+  // watch is being disarmed and the page stays writable
+  static bool fault(uintptr_t address, uintptr_t instruction, bool& step);
+  // ends the step of this thread, false if it was not stepping
+  static bool step();
+
+  // number of threads inside fault() or stepping
+  static std::atomic<size_t> handlers;
+
+ private:
+  static constexpr size_t capacity = 64;
+  static constexpr size_t released_capacity = 16;
+  static std::atomic<write_watch*> watches[capacity];
+  // pages of the last watches removed, as first page and end
+  static std::atomic<uintptr_t> released[released_capacity][2];
+  static std::atomic<size_t> released_count;
+  // removed watches whose pages may still be read only
+  static std::atomic<size_t> releasing;
+  static std::mutex mutex;
+
+  static write_watch* find(uintptr_t address);
+  static bool was_released(uintptr_t address);
+};
+
+std::atomic<size_t> watch_registry::handlers(0);
+std::atomic<write_watch*> watch_registry::watches[watch_registry::capacity];
+std::atomic<uintptr_t>
+    watch_registry::released[watch_registry::released_capacity][2];
+std::atomic<size_t> watch_registry::released_count(0);
+std::atomic<size_t> watch_registry::releasing(0);
+std::mutex watch_registry::mutex;
+}  // namespace mnemosyne
+
+namespace {
+// pages made writable for the step of a watched write, a write across a
+// page boundary needs two
+struct watch_step {
+  size_t pages;
+  uintptr_t page[2];
+  mnemosyne::write_watch* owner[2];
+  size_t index[2];
+  // watch to log into once the write is done, null for writes outside
+  // the watched range
+  mnemosyne::write_watch* logging;
+  mnemosyne::write_hit hit;
+  uint8_t before[16];
+  size_t captured;
+  // address of the last fault let through as one that raced a disarm, and
+  // the number of watches removed by then
+  uintptr_t retried;
+  size_t retried_after;
+};
+
+thread_local watch_step stepping = {};
+
+bool raw_protect(uintptr_t page, uint32_t protection) {
+#ifdef _WIN32
+  DWORD old = 0;
+  return VirtualProtect(reinterpret_cast<void*>(page),
+                        mnemosyne::platform::page_size(), protection, &old);
+#else
+  return mprotect(reinterpret_cast<void*>(page),
+                  mnemosyne::platform::page_size(),
+                  static_cast<int32_t>(protection)) == 0;
+#endif
+}
+
+uint32_t current_thread() {
+#ifdef _WIN32
+  return GetCurrentThreadId();
+#else
+  return static_cast<uint32_t>(syscall(SYS_gettid));
+#endif
+}
+
+bool on_watch_fault(uintptr_t address, uintptr_t instruction, bool& step) {
+  return mnemosyne::watch_registry::fault(address, instruction, step);
+}
+
+bool on_watch_step() {
+  return mnemosyne::watch_registry::step();
+}
+
+#ifdef _WIN32
+LONG CALLBACK on_watch_exception(EXCEPTION_POINTERS* exception) {
+  constexpr DWORD trap_flag = 0x100;
+  const EXCEPTION_RECORD* record = exception->ExceptionRecord;
+  CONTEXT* context = exception->ContextRecord;
+
+#ifdef _WIN64
+  uintptr_t instruction = context->Rip;
+#else
+  uintptr_t instruction = context->Eip;
+#endif
+
+  bool step = false;
+  if (record->ExceptionCode == EXCEPTION_ACCESS_VIOLATION &&
+      record->NumberParameters >= 2 && record->ExceptionInformation[0] == 1 &&
+      on_watch_fault(record->ExceptionInformation[1], instruction, step)) {
+    if (step) {
+      context->EFlags |= trap_flag;
+    }
+
+    return EXCEPTION_CONTINUE_EXECUTION;
+  }
+
+  if (record->ExceptionCode == EXCEPTION_SINGLE_STEP && on_watch_step()) {
+    context->EFlags &= ~trap_flag;
+    return EXCEPTION_CONTINUE_EXECUTION;
+  }
+
+  return EXCEPTION_CONTINUE_SEARCH;
+}
+
+void install_watch_handlers() {
+  static std::once_flag installed;
+  std::call_once(installed,
+                 []() { AddVectoredExceptionHandler(1, on_watch_exception); });
+}
+#else
+void install_watch_handlers() {
+  install_fault_handler();
+  install_trap_handler();
+}
+#endif
+}  // namespace
+
+bool mnemosyne::watch_registry::add(write_watch* watch) {
+  std::lock_guard<std::mutex> lock(mutex);
+  const size_t page_size = platform::page_size();
+
+  std::atomic<write_watch*>* free = nullptr;
+  for (auto& slot : watches) {
+    write_watch* other = slot.load();
+
+    if (!other) {
+      free = free ? free : &slot;
+    } else if (watch->first_page <
+                   other->first_page + other->page_count * page_size &&
+               other->first_page <
+                   watch->first_page + watch->page_count * page_size) {
+      return false;
+    }
+  }
+
+  if (free) {
+    free->store(watch);
+  }
+
+  return free != nullptr;
+}
+
+void mnemosyne::watch_registry::remove(write_watch* watch) {
+  std::lock_guard<std::mutex> lock(mutex);
+
+  for (auto& slot : watches) {
+    write_watch* expected = watch;
+    slot.compare_exchange_strong(expected, nullptr);
+  }
+
+  auto& range = released[released_count++ % released_capacity];
+  range[0].store(watch->first_page);
+  range[1].store(watch->first_page +
+                 watch->page_count * platform::page_size());
+  ++releasing;
+}
+
+void mnemosyne::watch_registry::restored() {
+  --releasing;
+}
+
+bool mnemosyne::watch_registry::was_released(uintptr_t address) {
+  for (const auto& range : released) {
+    if (range[0].load() <= address && address < range[1].load()) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+mnemosyne::write_watch* mnemosyne::watch_registry::find(uintptr_t address) {
+  const size_t page_size = platform::page_size();
+
+  for (auto& slot : watches) {
+    write_watch* watch = slot.load(std::memory_order_acquire);
+
+    if (watch && address - watch->first_page < watch->page_count * page_size) {
+      return watch;
+    }
+  }
+
+  return nullptr;
+}
+
+bool mnemosyne::watch_registry::fault(uintptr_t address,
+                                      uintptr_t instruction,
+                                      bool& step) {
+  const size_t page_size = platform::page_size();
+  const uintptr_t page = address & ~static_cast<uintptr_t>(page_size - 1);
+
+  // counted before the lookup, so disarm can wait out every handler that
+  // may have seen its watch
+  bool first = !stepping.pages;
+  if (first) {
+    ++handlers;
+  }
+
+  write_watch* watch = find(address);
+  if (!watch || stepping.pages == 2) {
+    if (first) {
+      --handlers;
+    }
+
+    // a write that faulted just before its watch was disarmed runs again
+    // until the disarm is done. a second fault after it, with no other
+    // disarm in between, is a real one
+    const size_t removed = released_count.load();
+    if (!watch && first &&
+        (releasing.load() || stepping.retried != address ||
+         stepping.retried_after != removed) &&
+        was_released(address)) {
+      stepping.retried = address;
+      stepping.retried_after = removed;
+      step = false;
+      return true;
+    }
+
+    stepping.retried = 0;
+    return false;
+  }
+
+  stepping.retried = 0;
+
+  size_t index = (page - watch->first_page) / page_size;
+
+  // the write goes through unwatched once disarming started. a thread
+  // already stepping keeps its trap flag, a new one must not set it
+  if (watch->disarming.load()) {
+    raw_protect(page, watch->original.at(index));
+    if (first) {
+      --handlers;
+    }
+
+    step = false;
+    return true;
+  }
+
+  if (first) {
+    stepping.logging = nullptr;
+
+    // writes to the rest of the page are only stepped over
+    if (address - watch->start < watch->size) {
+      stepping.logging = watch;
+      stepping.hit = {address, 0, instruction, current_thread()};
+      stepping.captured = std::min<size_t>(
+          sizeof(stepping.before), watch->start + watch->size - address);
+      memcpy(stepping.before, reinterpret_cast<const void*>(address),
+             stepping.captured);
+    }
+  }
+
+  stepping.page[stepping.pages] = page;
+  stepping.owner[stepping.pages] = watch;
+  stepping.index[stepping.pages] = index;
+  ++stepping.pages;
+
+  raw_protect(page, watch->original.at(index));
+  step = true;
+  return true;
+}
+
+bool mnemosyne::watch_registry::step() {
+  if (!stepping.pages) {
+    return false;
+  }
+
+  for (size_t n = 0; n < stepping.pages; ++n) {
+    write_watch* owner = stepping.owner[n];
+    raw_protect(stepping.page[n], owner->disarming.load()
+                                      ? owner->original.at(stepping.index[n])
+                                      : owner->watched.at(stepping.index[n]));
+  }
+
+  if (write_watch* watch = stepping.logging) {
+    auto after = reinterpret_cast<const uint8_t*>(stepping.hit.address);
+
+    for (size_t n = stepping.captured; n > 0; --n) {
+      if (after[n - 1] != stepping.before[n - 1]) {
+        stepping.hit.size = n;
+        break;
+      }
+    }
+
+    watch->push(stepping.hit);
+  }
+
+  stepping.pages = 0;
+  stepping.logging = nullptr;
+  --handlers;
+
+  return true;
+}
+
+mnemosyne::write_watch::write_watch(void* address,
+                                    size_t size,
+                                    size_t capacity)
+    : start(reinterpret_cast<uintptr_t>(address)),
+      size(size),
+      first_page(0),
+      page_count(0),
+      is_armed(false),
+      disarming(false),
+      tail(0),
+      head(0),
+      lost(0) {
+  const size_t page_size = platform::page_size();
+  const uintptr_t page_mask = ~static_cast<uintptr_t>(page_size - 1);
+
+  this->first_page = this->start & page_mask;
+  this->page_count =
+      size ? (((this->start + size - 1) & page_mask) - this->first_page) /
+                     page_size +
+                 1
+           : 0;
+
+  size_t slots = 1;
+  while (slots < capacity) {
+    slots <<= 1;
+  }
+
+  this->ring.resize(slots);
+  this->sequence.reset(new std::atomic<uint64_t>[slots]);
+  for (size_t n = 0; n < slots; ++n) {
+    this->sequence[n].store(n);
+  }
+}
+
+mnemosyne::write_watch::~write_watch() {
+  this->disarm();
+}
+
+bool mnemosyne::write_watch::arm() {
+#ifndef MNEMOSYNE_SINGLE_STEP
+  return false;
+#else
+  if (this->is_armed) {
+    return true;
+  }
+
+  if (!this->page_count) {
+    return false;
+  }
+
+  const size_t page_size = platform::page_size();
+  this->original.assign(this->page_count, 0);
+  this->watched.assign(this->page_count, 0);
+
+  for (size_t n = 0; n < this->page_count; ++n) {
+    memory_region region = {0, 0, false, false, false};
+
+    if (!platform::query(this->first_page + n * page_size, region) ||
+        !region.readable) {
+      return false;
+    }
+
+    this->original.at(n) = native_protection(region.readable, region.writable,
+                                             region.executable);
+    this->watched.at(n) =
+        native_protection(region.readable, false, region.executable);
+  }
+
+  install_watch_handlers();
+  this->disarming = false;
+
+  // registered before the pages turn read only, so no write is missed
+  if (!watch_registry::add(this)) {
+    return false;
+  }
+
+  for (size_t n = 0; n < this->page_count; ++n) {
+    uint32_t old = 0;
+
+    if (!change_protection(this->first_page + n * page_size, page_size,
+                           this->watched.at(n), old)) {
+      this->is_armed = true;
+      this->disarm();
+      return false;
+    }
+  }
+
+  platform::invalidate(reinterpret_cast<void*>(this->first_page),
+                       this->page_count * page_size);
+  this->is_armed = true;
+
+  return true;
+#endif
+}
+
+void mnemosyne::write_watch::disarm() {
+  if (!this->is_armed) {
+    return;
+  }
+
+  // faults from here on restore their page rather than step, so the
+  // handlers drain even under a stream of writes
+  this->disarming = true;
+
+  const size_t page_size = platform::page_size();
+  auto restore = [&]() {
+    for (size_t n = 0; n < this->page_count; ++n) {
+      uint32_t old = 0;
+      change_protection(this->first_page + n * page_size, page_size,
+                        this->original.at(n), old);
+    }
+  };
+
+  restore();
+
+  // handlers count themselves before the lookup, so once none are left no
+  // fault or step can still reach this watch
+  watch_registry::remove(this);
+  while (watch_registry::handlers.load()) {
+    std::this_thread::yield();
+  }
+
+  // a step that read disarming just before it was set may have made its
+  // page read only again
+  restore();
+  watch_registry::restored();
+
+  platform::invalidate(reinterpret_cast<void*>(this->first_page),
+                       this->page_count * page_size);
+  this->is_armed = false;
+}
+
+bool mnemosyne::write_watch::armed() const {
+  return this->is_armed;
+}
+
+size_t mnemosyne::write_watch::drain(std::vector<write_hit>& hits) {
+  const uint64_t mask = this->ring.size() - 1;
+  size_t count = 0;
+
+  for (;; ++this->head, ++count) {
+    std::atomic<uint64_t>& sequence = this->sequence[this->head & mask];
+    if (sequence.load(std::memory_order_acquire) != this->head + 1) {
+      break;
+    }
+
+    hits.push_back(this->ring.at(this->head & mask));
+    sequence.store(this->head + this->ring.size(), std::memory_order_release);
+  }
+
+  return count;
+}
+
+size_t mnemosyne::write_watch::dropped() const {
+  return this->lost.load();
+}
+
+void mnemosyne::write_watch::push(const write_hit& hit) {
+  const uint64_t mask = this->ring.size() - 1;
+  uint64_t position = this->tail.load(std::memory_order_relaxed);
+
+  for (;;) {
+    uint64_t sequence =
+        this->sequence[position & mask].load(std::memory_order_acquire);
+
+    if (sequence == position) {
+      if (this->tail.compare_exchange_weak(position, position + 1,
+                                           std::memory_order_relaxed)) {
+        break;
+      }
+    } else if (sequence < position) {
+      // full, the oldest hits are kept
+      ++this->lost;
+      return;
+    } else {
+      position = this->tail.load(std::memory_order_relaxed);
+    }
+  }
+
+  this->ring[position & mask] = hit;
+  this->sequence[position & mask].store(position + 1,
+                                        std::memory_order_release);
+}
+
+mnemosyne::memory_source::~memory_source() {}
+
+std::vector<bool> mnemosyne::memory_source::read_many(
+    const std::vector<request>& requests) {
+  batch into;
+  this->read_many(requests, into);
+
+  return into.results;
+}
+
+void mnemosyne::memory_source::read_many(const std::vector<request>& requests,
+                                         batch& into) {
+  into.results.assign(requests.size(), false);
+
+  for (size_t n = 0; n < requests.size(); ++n) {
+    into.results.at(n) = this->read(
+        requests.at(n).buffer, requests.at(n).address, requests.at(n).size);
+  }
+}
+
+std::vector<bool> mnemosyne::memory_source::write_many(
+    const std::vector<request>& requests) {
+  std::vector<bool> results(requests.size(), false);
+
+  for (size_t n = 0; n < requests.size(); ++n) {
+    results.at(n) = this->write(requests.at(n).address, requests.at(n).buffer,
+                                requests.at(n).size);
+  }
+
+  return results;
+}
+
+const uint8_t* mnemosyne::memory_source::in_place(uintptr_t, size_t) {
+  return nullptr;
+}
+
+mnemosyne::local_source& mnemosyne::local_source::instance() {
+  static local_source source;
+  return source;
+}
+
+bool mnemosyne::local_source::in_process() const {
+  return true;
+}
+
+bool mnemosyne::local_source::read(void* destination,
+                                   uintptr_t source,
+                                   size_t size) {
+  return platform::read(destination, reinterpret_cast<void*>(source), size);
+}
+
+bool mnemosyne::local_source::write(uintptr_t destination,
+                                    const void* source,
+                                    size_t size) {
+  return platform::write(reinterpret_cast<void*>(destination), source, size);
+}
+
+std::vector<mnemosyne::memory_region> mnemosyne::local_source::readable(
+    uintptr_t start,
+    size_t size) {
+  return regions::readable(start, size);
+}
+
+#ifdef _WIN32
+mnemosyne::remote_source::remote_source(uint32_t pid)
+    : target(pid),
+      process(OpenProcess(PROCESS_VM_READ | PROCESS_VM_WRITE |
+                              PROCESS_VM_OPERATION |
+                              PROCESS_QUERY_INFORMATION,
+                          false, pid)) {}
+
+mnemosyne::remote_source::~remote_source() {
+  if (this->process) {
+    CloseHandle(this->process);
+  }
+}
+
+bool mnemosyne::remote_source::attached() const {
+  return this->process != nullptr;
+}
+
+bool mnemosyne::remote_source::read(void* destination,
+                                    uintptr_t source,
+                                    size_t size) {
+  SIZE_T count = 0;
+  return ReadProcessMemory(this->process, reinterpret_cast<void*>(source),
+                           destination, size, &count) &&
+         count == size;
+}
+
+bool mnemosyne::remote_source::write(uintptr_t destination,
+                                     const void* source,
+                                     size_t size) {
+  SIZE_T count = 0;
+  return WriteProcessMemory(this->process, reinterpret_cast<void*>(destination),
+                            source, size, &count) &&
+         count == size;
+}
+
+std::vector<mnemosyne::memory_region> mnemosyne::remote_source::readable(
+    uintptr_t start,
+    size_t size) {
+  std::vector<memory_region> regions;
+  uintptr_t end = size > UINTPTR_MAX - start ? UINTPTR_MAX : start + size;
+
+  MEMORY_BASIC_INFORMATION mbi = {0};
+  for (uintptr_t address = start; address < end;) {
+    if (VirtualQueryEx(this->process, reinterpret_cast<void*>(address), &mbi,
+                       sizeof(MEMORY_BASIC_INFORMATION)) !=
+        sizeof(MEMORY_BASIC_INFORMATION)) {
+      break;
+    }
+
+    memory_region region = region_from(mbi);
+    uintptr_t low = std::max(region.start, start);
+    uintptr_t high = std::min(region.start + region.size, end);
+
+    if (mbi.State == MEM_COMMIT && region.readable && low < high) {
+      if (!regions.empty() &&
+          regions.back().start + regions.back().size == low) {
+        regions.back().size += high - low;
+      } else {
+        regions.push_back({low, high - low, true, region.writable,
+                           region.executable});
+      }
+    }
+
+    if (region.start + region.size <= address) {
+      break;
+    }
+
+    address = region.start + region.size;
+  }
+
+  return regions;
+}
+
+// ReadProcessMemory has no vectored form, every request is its own call
+void mnemosyne::remote_source::read_many(const std::vector<request>& requests,
+                                         batch& into) {
+  memory_source::read_many(requests, into);
+}
+
+std::vector<bool> mnemosyne::remote_source::write_many(
+    const std::vector<request>& requests) {
+  return memory_source::write_many(requests);
+}
+#else
+namespace {
+// runs as many requests as one process_vm_readv or process_vm_writev call
+// takes, starting over after the first request that did not complete. the
+// iovecs are built in the buffers of into
+template <typename F>
+void transfer_many(
+    const std::vector<mnemosyne::memory_source::request>& requests,
+    mnemosyne::memory_source::batch& into,
+    F transfer) {
+  std::vector<bool>& results = into.results;
+  std::vector<iovec>& local = into.local;
+  std::vector<iovec>& remote = into.remote;
+  results.assign(requests.size(), false);
+
+  for (size_t first = 0; first < requests.size();) {
+    size_t count = std::min<size_t>(requests.size() - first, IOV_MAX);
+
+    local.clear();
+    remote.clear();
+    for (size_t n = first; n < first + count; ++n) {
+      local.push_back({requests.at(n).buffer, requests.at(n).size});
+      remote.push_back({reinterpret_cast<void*>(requests.at(n).address),
+                        requests.at(n).size});
+    }
+
+    ssize_t done = transfer(local, remote);
+    size_t bytes = done < 0 ? 0 : static_cast<size_t>(done);
+
+    // requests complete in order until the first one that failed
+    size_t n = first;
+    for (; n < first + count && requests.at(n).size <= bytes; ++n) {
+      results.at(n) = true;
+      bytes -= requests.at(n).size;
+    }
+
+    first = n == first + count ? n : n + 1;
+  }
+}
+}  // namespace
+
+mnemosyne::remote_source::remote_source(uint32_t pid)
+    : target(pid),
+      memory_file(open(("/proc/" + std::to_string(pid) + "/mem").c_str(),
+                       O_RDWR | O_CLOEXEC)) {}
+
+mnemosyne::remote_source::~remote_source() {
+  if (this->memory_file >= 0) {
+    close(this->memory_file);
+  }
+}
+
+bool mnemosyne::remote_source::attached() const {
+  return this->memory_file >= 0;
+}
+
+bool mnemosyne::remote_source::read(void* destination,
+                                    uintptr_t source,
+                                    size_t size) {
+  // a single read needs no batch, read_plan retries failed spans with it
+  iovec local = {destination, size};
+  iovec remote = {reinterpret_cast<void*>(source), size};
+
+  return process_vm_readv(static_cast<pid_t>(this->target), &local, 1, &remote,
+                          1, 0) == static_cast<ssize_t>(size);
+}
+
+bool mnemosyne::remote_source::write(uintptr_t destination,
+                                     const void* source,
+                                     size_t size) {
+  return this->write_many({{destination, const_cast<void*>(source), size}})
+      .front();
+}
+
+std::vector<mnemosyne::memory_region> mnemosyne::remote_source::readable(
+    uintptr_t start,
+    size_t size) {
+  std::vector<memory_region> regions;
+  uintptr_t end = size > UINTPTR_MAX - start ? UINTPTR_MAX : start + size;
+
+  for (const auto& region :
+       parse_maps("/proc/" + std::to_string(this->target) + "/maps")) {
+    uintptr_t low = std::max(region.start, start);
+    uintptr_t high = std::min(region.start + region.size, end);
+
+    if (!region.readable || low >= high) {
+      continue;
+    }
+
+    if (!regions.empty() && regions.back().start + regions.back().size == low) {
+      regions.back().size += high - low;
+    } else {
+      regions.push_back(
+          {low, high - low, true, region.writable, region.executable});
+    }
+  }
+
+  return regions;
+}
+
+void mnemosyne::remote_source::read_many(const std::vector<request>& requests,
+                                         batch& into) {
+  transfer_many(requests, into, [this](const std::vector<iovec>& local,
+                                       const std::vector<iovec>& remote) {
+    return process_vm_readv(static_cast<pid_t>(this->target), local.data(),
+                            local.size(), remote.data(), remote.size(), 0);
+  });
+}
+
+std::vector<bool> mnemosyne::remote_source::write_many(
+    const std::vector<request>& requests) {
+  batch into;
+  transfer_many(requests, into, [this](const std::vector<iovec>& local,
+                                       const std::vector<iovec>& remote) {
+    return process_vm_writev(static_cast<pid_t>(this->target), local.data(),
+                             local.size(), remote.data(), remote.size(), 0);
+  });
+
+  std::vector<bool>& results = into.results;
+
+  // process_vm_writev honors the page protection of the target, the mem
+  // file writes through it like a debugger would
+  for (size_t n = 0; n < requests.size(); ++n) {
+    if (!results.at(n) && this->memory_file >= 0) {
+      results.at(n) =
+          pwrite(this->memory_file, requests.at(n).buffer, requests.at(n).size,
+                 static_cast<off_t>(requests.at(n).address)) ==
+          static_cast<ssize_t>(requests.at(n).size);
+    }
+  }
+
+  return results;
+}
+#endif
+
+uint32_t mnemosyne::remote_source::pid() const {
+  return this->target;
+}
+
+bool mnemosyne::remote_source::in_process() const {
+  return false;
+}
+
+mnemosyne::address::address() : ptr(nullptr), source(nullptr) {
+#ifdef _WIN32
+  HANDLE process = GetCurrentProcess();
+  HANDLE token = 0;
+  if (OpenProcessToken(process, TOKEN_ADJUST_PRIVILEGES, &token)) {
+    CloseHandle(token);
+    CloseHandle(process);
+    return;
+  }
+
+  LUID luid = {0};
+  if (!LookupPrivilegeValueA(0, "SeDebugPrivilege", &luid)) {
+    CloseHandle(token);
+    CloseHandle(process);
+    return;
+  }
+
+  TOKEN_PRIVILEGES privileges = {0};
+  privileges.PrivilegeCount = 1;
+  privileges.Privileges[0].Luid = luid;
+  privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+  AdjustTokenPrivileges(token, false, &privileges, 0, 0, 0);
+
+  CloseHandle(token);
+  CloseHandle(process);
+#endif
+}
+
+mnemosyne::address::address(void* ptr) : address::address() {
+  this->ptr = ptr;
+}
+
+mnemosyne::address::address(uintptr_t intptr) : address::address() {
+  this->ptr = reinterpret_cast<void*>(intptr);
+}
+
+mnemosyne::address::address(memory_source& source, uintptr_t intptr)
+    : address::address() {
+  this->ptr = reinterpret_cast<void*>(intptr);
+  this->source = &source;
+}
+
+void* mnemosyne::address::as_ptr() {
+  return this->ptr;
+}
+
+uintptr_t mnemosyne::address::as_int() {
+  return reinterpret_cast<uintptr_t>(this->ptr);
+}
+
+const std::vector<uint8_t> mnemosyne::address::read_memory(size_t size) {
+  std::vector<uint8_t> memory(size);
+
+  if (!this->read_into(memory.data(), size)) {
+    memory.clear();
+  }
+
+  return memory;
+}
+
+bool mnemosyne::address::read_into(void* destination, size_t size) {
+  // readable memory needs no protection change
+  if (this->read_raw(destination, this->as_int(), size)) {
+    return true;
+  }
+
+  if (this->remote()) {
+    return false;
+  }
+
+  return this->with_page_execute_read_write(size, [&]() {
+    return memcpy(destination, this->ptr, size) != nullptr;
+  });
+}
+
+mnemosyne::partial_read mnemosyne::address::read_available(void* destination,
+                                                          size_t size) {
+  const uintptr_t start = this->as_int();
+  const size_t page_size = platform::page_size();
+  const uintptr_t first_page = start & ~static_cast<uintptr_t>(page_size - 1);
+
+  partial_read result = {0, {}};
+  if (!size || start + size < start) {
+    return result;
+  }
+
+  result.pages.assign((start + size - 1 - first_page) / page_size + 1, false);
+
+  auto copy = [&](uintptr_t low, uintptr_t high) {
+    if (!this->read_raw(static_cast<uint8_t*>(destination) + (low - start),
+                        low, high - low)) {
+      return false;
+    }
+
+    result.bytes += high - low;
+    for (uintptr_t page = low & ~static_cast<uintptr_t>(page_size - 1);
+         page < high; page += page_size) {
+      result.pages.at((page - first_page) / page_size) = true;
+    }
+
+    return true;
+  };
+
+  // the common case, all of it readable, needs no walk of the regions
+  if (copy(start, start + size)) {
+    return result;
+  }
+
+  memset(destination, 0, size);
+
+  for (const auto& region : this->remote()
+                                 ? this->source->readable(start, size)
+                                 : regions::readable(start, size)) {
+    const uintptr_t end = region.start + region.size;
+    if (copy(region.start, end)) {
+      continue;
+    }
+
+    // the region changed since it was queried, salvage it page by page
+    platform::invalidate(reinterpret_cast<void*>(region.start), region.size);
+    for (uintptr_t low = region.start; low < end;) {
+      uintptr_t high = std::min(
+          end, (low & ~static_cast<uintptr_t>(page_size - 1)) + page_size);
+      if (!copy(low, high)) {
+        memset(static_cast<uint8_t*>(destination) + (low - start), 0,
+               high - low);
+      }
+
+      low = high;
+    }
+  }
+
+  return result;
+}
+
+mnemosyne::memory_view mnemosyne::address::view(size_t size) {
+  const uintptr_t start = this->as_int();
+
+  if (!start || start + size < start || this->remote()) {
+    return {nullptr, 0};
+  }
+
+  for (uintptr_t cursor = start; cursor < start + size;) {
+    memory_region region = {0, 0, false, false, false};
+    if (!platform::query(cursor, region) || !region.readable) {
+      return {nullptr, 0};
+    }
+
+    cursor = region.start + region.size;
+  }
+
+  return {static_cast<const uint8_t*>(this->ptr), size};
+}
+
+bool mnemosyne::address::write_memory(const std::vector<uint8_t>& bytes) {
+  if (this->remote()) {
+    return this->write_raw(this->as_int(), bytes.data(), bytes.size());
+  }
+
+  return this->with_page_execute_read_write(bytes.size(), [&]() {
+    for (size_t i = 0; i < bytes.size(); ++i) {
+      *reinterpret_cast<uint8_t*>(this->as_int() + i) = bytes.at(i);
+    }
+
+    return true;
+  });
+}
+
+bool mnemosyne::address::copy_memory(const void* bytes, size_t size) {
+  if (this->remote()) {
+    return this->write_raw(this->as_int(), bytes, size);
+  }
+
+  return this->with_page_execute_read_write(size, [this, bytes, size]() {
+    return memcpy(this->ptr, bytes, size) != nullptr;
+  });
+}
+
+bool mnemosyne::address::fill_memory(uint8_t byte, size_t size) {
+  if (this->remote()) {
+    return this->write_raw(this->as_int(),
+                           std::vector<uint8_t>(size, byte).data(), size);
+  }
+
+  return this->with_page_execute_read_write(size, [this, byte, size]() {
+    return memset(this->ptr, byte, size) != nullptr;
+  });
+}
+
+uintptr_t mnemosyne::address::code_cave(const std::vector<uint8_t>& code) {
+  if (this->remote() || code.empty()) {
+    return 0;
+  }
+
+  code_arena& arena = code_arena::shared();
+  uintptr_t cave = arena.allocate(this->as_int(), code.size());
+
+  if (cave && !arena.write(cave, code.data(), code.size())) {
+    arena.release(cave);
+    return 0;
+  }
+
+  return cave;
+}
+
+bool mnemosyne::address::remote() const {
+  return this->source && !this->source->in_process();
+}
+
+bool mnemosyne::address::read_raw(void* destination,
+                                  uintptr_t source,
+                                  size_t size) {
+  return this->source
+             ? this->source->read(destination, source, size)
+             : platform::read(destination, reinterpret_cast<void*>(source),
+                              size);
+}
+
+bool mnemosyne::address::write_raw(uintptr_t destination,
+                                   const void* source,
+                                   size_t size) {
+  return this->source
+             ? this->source->write(destination, source, size)
+             : platform::write(reinterpret_cast<void*>(destination), source,
+                               size);
+}
+
+mnemosyne::write_batch::write_batch() {}
+
+size_t mnemosyne::write_batch::add(address ptr,
+                                   const std::vector<uint8_t>& bytes) {
+  return this->add(ptr.as_ptr(), bytes.data(), bytes.size());
+}
+
+size_t mnemosyne::write_batch::add(void* destination,
+                                   const void* bytes,
+                                   size_t size) {
+  this->entries.push_back(
+      {reinterpret_cast<uintptr_t>(destination), this->data.size(), size});
+  this->data.insert(this->data.end(), static_cast<const uint8_t*>(bytes),
+                    static_cast<const uint8_t*>(bytes) + size);
+
+  return this->entries.size() - 1;
+}
+
+std::vector<bool> mnemosyne::write_batch::apply() {
+  std::vector<bool> results(this->entries.size(), false);
+
+  std::vector<size_t> order(this->entries.size());
+  for (size_t n = 0; n < order.size(); ++n) {
+    order.at(n) = n;
+  }
+
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return this->entries.at(a).address < this->entries.at(b).address;
+  });
+
+  // merge the pages of all writes into contiguous [start, end) spans
+  const uintptr_t page_mask =
+      ~static_cast<uintptr_t>(platform::page_size() - 1);
+  std::vector<std::pair<uintptr_t, uintptr_t>> spans;
+
+  for (size_t n : order) {
+    const entry& e = this->entries.at(n);
+    if (!e.size) {
+      continue;
+    }
+
+    uintptr_t start = e.address & page_mask;
+    uintptr_t end =
+        ((e.address + e.size - 1) & page_mask) + platform::page_size();
+
+    if (!spans.empty() && start <= spans.back().second) {
+      spans.back().second = std::max(spans.back().second, end);
+    } else {
+      spans.emplace_back(start, end);
+    }
+  }
+
+  std::vector<platform::protection_change> changes(spans.size());
+  for (size_t n = 0; n < spans.size(); ++n) {
+    platform::make_writable(reinterpret_cast<void*>(spans.at(n).first),
+                            spans.at(n).second - spans.at(n).first,
+                            changes.at(n));
+  }
+
+  // later writes to the same bytes win, as if applied one by one
+  for (size_t n = 0; n < this->entries.size(); ++n) {
+    const entry& e = this->entries.at(n);
+    results.at(n) = platform::write(reinterpret_cast<void*>(e.address),
+                                    this->data.data() + e.offset, e.size);
+  }
+
+  for (const auto& change : changes) {
+    platform::restore(change);
+  }
+
+  return results;
+}
+
+void mnemosyne::write_batch::clear() {
+  this->entries.clear();
+  this->data.clear();
+}
+
+size_t mnemosyne::write_batch::size() const {
+  return this->entries.size();
+}
+
+mnemosyne::pointer_chain::pointer_chain(uintptr_t base,
+                                        const std::vector<size_t>& offsets)
+    : source(nullptr),
+      base(base),
+      offsets(offsets),
+      pointers(offsets.size(), 0),
+      target(0),
+      cached(false) {}
+
+mnemosyne::pointer_chain::pointer_chain(memory_source& source,
+                                        uintptr_t base,
+                                        const std::vector<size_t>& offsets)
+    : pointer_chain(base, offsets) {
+  this->source = &source;
+}
+
+uintptr_t mnemosyne::pointer_chain::resolve() {
+  uintptr_t root = 0;
+
+  if (this->offsets.empty() ||
+      !this->load(&root, this->base, sizeof(uintptr_t))) {
+    this->cached = false;
+    return 0;
+  }
+
+  if (this->cached && root == this->pointers.front()) {
+    return this->target;
+  }
+
+  return this->walk(root);
+}
+
+uintptr_t mnemosyne::pointer_chain::refresh() {
+  this->cached = false;
+  return this->resolve();
+}
+
+void mnemosyne::pointer_chain::invalidate() {
+  this->cached = false;
+}
+
+bool mnemosyne::pointer_chain::load(void* destination,
+                                    uintptr_t source,
+                                    size_t size) {
+  return this->source
+             ? this->source->read(destination, source, size)
+             : platform::read(destination, reinterpret_cast<void*>(source),
+                              size);
+}
+
+bool mnemosyne::pointer_chain::store(uintptr_t destination,
+                                     const void* source,
+                                     size_t size) {
+  return this->source
+             ? this->source->write(destination, source, size)
+             : platform::write(reinterpret_cast<void*>(destination), source,
+                               size);
+}
+
+uintptr_t mnemosyne::pointer_chain::walk(uintptr_t root) {
+  this->cached = false;
+  this->pointers.front() = root;
+
+  for (size_t level = 1; level < this->pointers.size(); ++level) {
+    if (!this->load(&this->pointers.at(level),
+                    this->pointers.at(level - 1) + this->offsets.at(level - 1),
+                    sizeof(uintptr_t))) {
+      return 0;
+    }
+  }
+
+  this->target = this->pointers.back() + this->offsets.back();
+  this->cached = true;
+
+  return this->target;
+}
+
+bool mnemosyne::pointer_chain::access(void* buffer,
+                                      size_t size,
+                                      bool is_write) {
+  for (int32_t attempt = 0; attempt < 2; ++attempt) {
+    uintptr_t address = attempt ? this->refresh() : this->resolve();
+
+    if (address && (is_write ? this->store(address, buffer, size)
+                             : this->load(buffer, address, size))) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+mnemosyne::pointer_chain mnemosyne::pointer_scan::path::chain() const {
+  return pointer_chain(regions::module_range(this->module).start + this->offset,
+                       this->offsets);
+}
+
+mnemosyne::pointer_scan::pointer_scan(size_t threads)
+    : modules(regions::modules()), threads(threads) {
+  memory_region range = regions::process_range();
+  std::vector<memory_region> readable =
+      regions::readable(range.start, range.size);
+
+  std::vector<memory_region> writable;
+  for (const auto& region : regions::query(range.start, range.size)) {
+    if (region.readable && region.writable) {
+      writable.push_back(region);
+    }
+  }
+
+  auto points_into_memory = [&](uintptr_t value) {
+    auto it = std::upper_bound(
+        readable.begin(), readable.end(), value,
+        [](uintptr_t v, const memory_region& r) { return v < r.start; });
+
+    return it != readable.begin() &&
+           value - (it - 1)->start < (it - 1)->size;
+  };
+
+  auto chunks = split_into_chunks(writable, sizeof(uintptr_t));
+  std::vector<std::vector<std::pair<uintptr_t, uintptr_t>>> found(
+      chunks.size());
+
+  for_each_chunk(chunks.size(), threads, [&](size_t chunk) {
+    const uintptr_t alignment = sizeof(uintptr_t) - 1;
+    uintptr_t first = (chunks.at(chunk).first + alignment) & ~alignment;
+    uintptr_t last = chunks.at(chunk).second;
+
+    // a page freed since the query only costs the rest of the chunk
+    platform::guarded([&]() {
+      for (uintptr_t location = first; location <= last;
+           location += sizeof(uintptr_t)) {
+        uintptr_t value = *reinterpret_cast<const uintptr_t*>(location);
+
+        if (value && points_into_memory(value)) {
+          found.at(chunk).emplace_back(value, location);
+        }
+      }
+    });
+  });
+
+  size_t total = 0;
+  for (const auto& chunk : found) {
+    total += chunk.size();
+  }
+
+  this->pointers.reserve(total);
+  for (const auto& chunk : found) {
+    this->pointers.insert(this->pointers.end(), chunk.begin(), chunk.end());
+  }
+
+  std::sort(this->pointers.begin(), this->pointers.end());
+}
+
+std::vector<mnemosyne::pointer_scan::path>
+mnemosyne::pointer_scan::find_paths(uintptr_t target,
+                                    size_t max_depth,
+                                    size_t max_offset,
+                                    size_t max_results) {
+  if (!max_depth) {
+    return {};
+  }
+
+  auto first = std::lower_bound(
+      this->pointers.begin(), this->pointers.end(),
+      std::make_pair(target - std::min<uintptr_t>(target, max_offset),
+                     uintptr_t(0)));
+  auto last = std::upper_bound(this->pointers.begin(), this->pointers.end(),
+                               std::make_pair(target, UINTPTR_MAX));
+
+  // the pointers to the target are searched in parallel, each one deeper
+  // on its own thread
+  std::vector<std::pair<uintptr_t, uintptr_t>> candidates(first, last);
+  std::vector<std::vector<path>> found(candidates.size());
+
+  for_each_chunk(candidates.size(), this->threads, [&](size_t chunk) {
+    const auto& candidate = candidates.at(chunk);
+    std::vector<size_t> offsets = {target - candidate.first};
+
+    if (const loaded_module* module = this->module_of(candidate.second)) {
+      found.at(chunk).push_back(
+          {module->name, candidate.second - module->range.start, offsets});
+    }
+
+    this->search(candidate.second, max_depth - 1, max_offset, max_results,
+                 offsets, found.at(chunk));
+  });
+
+  std::vector<path> paths;
+  for (auto& chunk : found) {
+    for (auto& p : chunk) {
+      // offsets were collected from the target back to the static
+      std::reverse(p.offsets.begin(), p.offsets.end());
+      paths.push_back(std::move(p));
+    }
+  }
+
+  std::sort(paths.begin(), paths.end(), [](const path& a, const path& b) {
+    return std::tie(a.module, a.offset, a.offsets) <
+           std::tie(b.module, b.offset, b.offsets);
+  });
+
+  if (paths.size() > max_results) {
+    paths.resize(max_results);
+  }
+
+  return paths;
+}
+
+size_t mnemosyne::pointer_scan::size() const {
+  return this->pointers.size();
+}
+
+const mnemosyne::loaded_module* mnemosyne::pointer_scan::module_of(
+    uintptr_t address) const {
+  for (const auto& module : this->modules) {
+    if (address - module.range.start < module.range.size) {
+      return &module;
+    }
+  }
+
+  return nullptr;
+}
+
+void mnemosyne::pointer_scan::search(uintptr_t address,
+                                     size_t depth,
+                                     size_t max_offset,
+                                     size_t max_results,
+                                     std::vector<size_t>& offsets,
+                                     std::vector<path>& paths) const {
+  if (!depth) {
+    return;
+  }
+
+  auto it = std::lower_bound(
+      this->pointers.begin(), this->pointers.end(),
+      std::make_pair(address - std::min<uintptr_t>(address, max_offset),
+                     uintptr_t(0)));
+
+  for (; it != this->pointers.end() && it->first <= address; ++it) {
+    if (paths.size() >= max_results) {
+      return;
+    }
+
+    offsets.push_back(address - it->first);
+
+    if (const loaded_module* module = this->module_of(it->second)) {
+      paths.push_back(
+          {module->name, it->second - module->range.start, offsets});
+    }
+
+    this->search(it->second, depth - 1, max_offset, max_results, offsets,
+                 paths);
+    offsets.pop_back();
+  }
+}
+
+namespace {
+// a value_candidates block covers this much address space
+constexpr size_t value_block_size = 0x10000;
+
+// offsets from start of the slots in [start, last] holding value, plus
+// first_slot, every slot has size readable bytes
+void find_value_scalar(uintptr_t start,
+                       uintptr_t last,
+                       const uint8_t* value,
+                       size_t size,
+                       size_t alignment,
+                       size_t first_slot,
+                       std::vector<uint16_t>& slots) {
+  for (uintptr_t at = start; at <= last; at += alignment) {
+    if (!memcmp(reinterpret_cast<const void*>(at), value, size)) {
+      slots.push_back(
+          static_cast<uint16_t>(first_slot + (at - start) / alignment));
+    }
+
+    if (last - at < alignment) {
+      break;
+    }
+  }
+}
+
+#ifdef MNEMOSYNE_X86
+// compares 16 bytes at a time against the value repeated, for sizes of 1,
+// 2, 4 or 8 bytes aligned to their size
+MNEMOSYNE_TARGET_SSE2 void find_value_sse2(uintptr_t start,
+                                           uintptr_t last,
+                                           const uint8_t* value,
+                                           size_t size,
+                                           std::vector<uint16_t>& slots) {
+  uint8_t repeated[sizeof(__m128i)];
+  for (size_t n = 0; n < sizeof(__m128i); ++n) {
+    repeated[n] = value[n % size];
+  }
+
+  const __m128i needle =
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(repeated));
+  // lowest bit of every slot in a movemask
+  const uint32_t slot_bits =
+      size == 1 ? 0xffff : size == 2 ? 0x5555 : size == 4 ? 0x1111 : 0x0101;
+
+  uintptr_t at = start;
+  for (; at <= last && last + size - at >= sizeof(__m128i);
+       at += sizeof(__m128i)) {
+    uint32_t equal = static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(at)), needle)));
+
+    // a slot matches if all of its bytes do
+    uint32_t matches = equal;
+    for (size_t n = 1; n < size; ++n) {
+      matches &= equal >> n;
+    }
+
+    for (matches &= slot_bits; matches; matches &= matches - 1) {
+      uintptr_t slot = at + count_trailing_zeros(matches);
+      if (slot <= last) {
+        slots.push_back(static_cast<uint16_t>((slot - start) / size));
+      }
+    }
+  }
+
+  // runs inside guarded(), so the tail goes straight into slots rather
+  // than through a vector a fault would leak
+  if (at <= last) {
+    find_value_scalar(at, last, value, size, size, (at - start) / size, slots);
+  }
+}
+#endif
+}  // namespace
+
+mnemosyne::value_candidates::value_candidates(uintptr_t memory_start,
+                                              size_t memory_size,
+                                              size_t value_size,
+                                              size_t alignment)
+    : memory_start(memory_start),
+      memory_size(memory_size),
+      value_size(value_size),
+      alignment(std::max<size_t>(alignment, 1)) {}
+
+size_t mnemosyne::value_candidates::slots_per_block() const {
+  return value_block_size / this->alignment;
+}
+
+void mnemosyne::value_candidates::pack(
+    block& b,
+    const std::vector<uint16_t>& slots) const {
+  b.count = slots.size();
+  b.bits.clear();
+  b.slots.clear();
+
+  // a slot costs 16 bits in the array and one in the bitmap
+  if (slots.size() * 16 > this->slots_per_block()) {
+    b.bits.assign((this->slots_per_block() + 63) / 64, 0);
+    for (uint16_t slot : slots) {
+      b.bits.at(slot / 64) |= uint64_t(1) << (slot % 64);
+    }
+  } else {
+    b.slots = slots;
+  }
+}
+
+template <typename F>
+void mnemosyne::value_candidates::for_each_slot(const block& b,
+                                                F callback) const {
+  if (b.bits.empty()) {
+    for (size_t n = 0; n < b.slots.size(); ++n) {
+      callback(n, b.start + b.slots[n] * this->alignment);
+    }
+
+    return;
+  }
+
+  size_t n = 0;
+  for (size_t word = 0; word < b.bits.size(); ++word) {
+    for (uint64_t bits = b.bits[word]; bits; bits &= bits - 1) {
+      uint32_t low = static_cast<uint32_t>(bits);
+      size_t bit = low ? count_trailing_zeros(low)
+                       : 32 + count_trailing_zeros(
+                                  static_cast<uint32_t>(bits >> 32));
+
+      callback(n++, b.start + (word * 64 + bit) * this->alignment);
+    }
+  }
+}
+
+size_t mnemosyne::value_candidates::first_scan(const void* value) {
+  this->blocks = this->find(
+      regions::readable(this->memory_start, this->memory_size), value);
+  return this->size();
+}
+
+std::vector<mnemosyne::value_candidates::block>
+mnemosyne::value_candidates::find(const std::vector<memory_region>& regions,
+                                  const void* value) const {
+  auto chunks = split_into_chunks(regions, this->value_size);
+  std::vector<std::vector<block>> found(chunks.size());
+  const auto bytes = static_cast<const uint8_t*>(value);
+
+  for_each_chunk(chunks.size(), 0, [&](size_t chunk) {
+    const uintptr_t last = chunks.at(chunk).second;
+    uintptr_t first = chunks.at(chunk).first + this->alignment - 1;
+    first -= first % this->alignment;
+
+    std::vector<uint16_t> slots;
+
+    // a page freed since the query only costs the rest of the chunk
+    platform::guarded([&]() {
+      for (uintptr_t start = first; start <= last;
+           start += value_block_size) {
+        uintptr_t block_last =
+            start + std::min<uintptr_t>(last - start, value_block_size - 1);
+        slots.clear();
+
+#ifdef MNEMOSYNE_X86
+        if (this->alignment == this->value_size &&
+            (this->value_size == 1 || this->value_size == 2 ||
+             this->value_size == 4 || this->value_size == 8)) {
+          find_value_sse2(start, block_last, bytes, this->value_size, slots);
+        } else {
+          find_value_scalar(start, block_last, bytes, this->value_size,
+                            this->alignment, 0, slots);
+        }
+#else
+        find_value_scalar(start, block_last, bytes, this->value_size,
+                          this->alignment, 0, slots);
+#endif
+
+        if (!slots.empty()) {
+          block b = {start, 0, {}, {}, {}};
+          this->pack(b, slots);
+
+          b.values.resize(slots.size() * this->value_size);
+          for (size_t n = 0; n < slots.size(); ++n) {
+            memcpy(b.values.data() + n * this->value_size, bytes,
+                   this->value_size);
+          }
+
+          found.at(chunk).push_back(std::move(b));
+        }
+
+        if (block_last == last) {
+          break;
+        }
+      }
+    });
+  });
+
+  std::vector<block> blocks;
+  for (auto& chunk : found) {
+    std::move(chunk.begin(), chunk.end(), std::back_inserter(blocks));
+  }
+
+  return blocks;
+}
+
+size_t mnemosyne::value_candidates::next_scan(predicate keep,
+                                              const void* value) {
+  for_each_chunk(this->blocks.size(), 0, [&](size_t index) {
+    block& b = this->blocks.at(index);
+
+    uintptr_t low = UINTPTR_MAX, high = 0;
+    this->for_each_slot(b, [&](size_t, uintptr_t address) {
+      low = std::min(low, address);
+      high = std::max(high, address + this->value_size);
+    });
+
+    // one guarded copy of the span holding the candidates, falling back to
+    // a copy per candidate if part of it is gone
+    std::vector<uint8_t> current(high - low);
+    std::vector<bool> readable;
+    if (!platform::read(current.data(), reinterpret_cast<void*>(low),
+                        current.size())) {
+      readable.assign(b.count, false);
+      this->for_each_slot(b, [&](size_t n, uintptr_t address) {
+        readable.at(n) = platform::read(current.data() + (address - low),
+                                        reinterpret_cast<void*>(address),
+                                        this->value_size);
+      });
+    }
+
+    std::vector<uint16_t> slots;
+    std::vector<uint8_t> values;
+    this->for_each_slot(b, [&](size_t n, uintptr_t address) {
+      const uint8_t* now = current.data() + (address - low);
+
+      if ((readable.empty() || readable.at(n)) &&
+          keep(now, b.values.data() + n * this->value_size, value)) {
+        slots.push_back(
+            static_cast<uint16_t>((address - b.start) / this->alignment));
+        values.insert(values.end(), now, now + this->value_size);
+      }
+    });
+
+    this->pack(b, slots);
+    b.values = std::move(values);
+  });
+
+  this->blocks.erase(
+      std::remove_if(this->blocks.begin(), this->blocks.end(),
+                     [](const block& b) { return !b.count; }),
+      this->blocks.end());
+
+  return this->size();
+}
+
+size_t mnemosyne::value_candidates::rescan(
+    const void* value,
+    const std::vector<snapshot::range>& dirty) {
+  auto starts =
+      overlapping_starts(dirty, this->value_size, this->memory_start,
+                         this->memory_start + this->memory_size);
+  if (starts.empty()) {
+    return this->size();
+  }
+
+  // blocks reaching into a dirty range are rebuilt from their candidates
+  // outside of it and the locations found in it
+  std::vector<block> untouched;
+  std::vector<uintptr_t> kept;
+  std::vector<uint8_t> kept_values;
+  for (auto& b : this->blocks) {
+    if (!overlaps_ranges(starts, b.start, value_block_size)) {
+      untouched.push_back(std::move(b));
+      continue;
+    }
+
+    this->for_each_slot(b, [&](size_t n, uintptr_t address) {
+      if (!overlaps_ranges(starts, address, 1)) {
+        kept.push_back(address);
+        kept_values.insert(
+            kept_values.end(), b.values.data() + n * this->value_size,
+            b.values.data() + (n + 1) * this->value_size);
+      }
+    });
+  }
+
+  std::vector<uintptr_t> found;
+  for (const auto& b : this->find(
+           regions_of_starts(
+               regions::readable(this->memory_start, this->memory_size),
+               starts, this->value_size),
+           value)) {
+    this->for_each_slot(
+        b, [&](size_t, uintptr_t address) { found.push_back(address); });
+  }
+
+  this->blocks.clear();
+  std::vector<uint16_t> slots;
+  block current = {0, 0, {}, {}, {}};
+  size_t next = 0;
+
+  auto close = [&]() {
+    if (!slots.empty()) {
+      this->pack(current, slots);
+      this->blocks.push_back(std::move(current));
+      slots.clear();
+    }
+  };
+
+  // in address order, a block ends before the next untouched one starts
+  auto add = [&](uintptr_t address, const void* bytes) {
+    while (next < untouched.size() && untouched.at(next).start <= address) {
+      close();
+      this->blocks.push_back(std::move(untouched.at(next++)));
+    }
+
+    if (!slots.empty() && address - current.start >= value_block_size) {
+      close();
+    }
+
+    if (slots.empty()) {
+      current = {address, 0, {}, {}, {}};
+    }
+
+    slots.push_back(
+        static_cast<uint16_t>((address - current.start) / this->alignment));
+    auto begin = static_cast<const uint8_t*>(bytes);
+    current.values.insert(current.values.end(), begin,
+                          begin + this->value_size);
+  };
+
+  size_t n = 0, m = 0;
+  while (n < kept.size() || m < found.size()) {
+    if (m == found.size() || (n < kept.size() && kept.at(n) < found.at(m))) {
+      add(kept.at(n), kept_values.data() + n * this->value_size);
+      ++n;
+    } else {
+      add(found.at(m++), value);
+    }
+  }
+
+  close();
+  std::move(untouched.begin() + next, untouched.end(),
+            std::back_inserter(this->blocks));
+
+  return this->size();
+}
+
+size_t mnemosyne::value_candidates::size() const {
+  size_t count = 0;
+  for (const auto& b : this->blocks) {
+    count += b.count;
+  }
+
+  return count;
+}
+
+std::vector<uintptr_t> mnemosyne::value_candidates::addresses(
+    size_t limit) const {
+  std::vector<uintptr_t> addresses;
+  addresses.reserve(std::min(limit, this->size()));
+
+  for (const auto& b : this->blocks) {
+    this->for_each_slot(b, [&](size_t, uintptr_t address) {
+      if (addresses.size() < limit) {
+        addresses.push_back(address);
+      }
+    });
+  }
+
+  return addresses;
+}
+
+bool mnemosyne::value_candidates::previous(uintptr_t address,
+                                           void* value) const {
+  auto it = std::upper_bound(
+      this->blocks.begin(), this->blocks.end(), address,
+      [](uintptr_t a, const block& b) { return a < b.start; });
+  if (it == this->blocks.begin()) {
+    return false;
+  }
+
+  bool found = false;
+  this->for_each_slot(*(it - 1), [&](size_t n, uintptr_t at) {
+    if (at == address) {
+      memcpy(value, (it - 1)->values.data() + n * this->value_size,
+             this->value_size);
+      found = true;
+    }
+  });
+
+  return found;
+}
+
+namespace {
+constexpr uint64_t hash_prime_1 = 0x9e3779b185ebca87;
+constexpr uint64_t hash_prime_2 = 0xc2b2ae3d27d4eb4f;
+constexpr uint64_t hash_prime_3 = 0x165667b19e3779f9;
+
+inline uint64_t rotate_left(uint64_t value, uint32_t bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+inline uint64_t hash_round(uint64_t lane, uint64_t input) {
+  return rotate_left(lane + input * hash_prime_2, 31) * hash_prime_1;
+}
+
+// xxhash64 style hash of a page, four independent lanes of 8 bytes so the
+// multiplies pipeline. size is a multiple of 32
+uint64_t hash_page(const uint8_t* bytes, size_t size) {
+  uint64_t lanes[4] = {hash_prime_1 + hash_prime_2, hash_prime_2, 0,
+                       0 - hash_prime_1};
+
+  for (size_t n = 0; n < size; n += 32) {
+    for (size_t lane = 0; lane < 4; ++lane) {
+      uint64_t input = 0;
+      memcpy(&input, bytes + n + lane * 8, sizeof(uint64_t));
+      lanes[lane] = hash_round(lanes[lane], input);
+    }
+  }
+
+  uint64_t hash = rotate_left(lanes[0], 1) + rotate_left(lanes[1], 7) +
+                  rotate_left(lanes[2], 12) + rotate_left(lanes[3], 18);
+  for (uint64_t lane : lanes) {
+    hash = (hash ^ hash_round(0, lane)) * hash_prime_1 + hash_prime_3;
+  }
+
+  hash ^= hash >> 33;
+  hash *= hash_prime_2;
+  hash ^= hash >> 29;
+
+  return hash ^ (hash >> 32);
+}
+
+#ifdef MNEMOSYNE_X86
+// bit n set if byte n of the 16 at x and y differs
+MNEMOSYNE_TARGET_SSE2 inline uint32_t differing_bytes_sse2(const uint8_t* x,
+                                                           const uint8_t* y) {
+  return ~static_cast<uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(
+             _mm_loadu_si128(reinterpret_cast<const __m128i*>(x)),
+             _mm_loadu_si128(reinterpret_cast<const __m128i*>(y))))) &
+         0xffff;
+}
+#endif
+
+// appends the runs of differing bytes, address is that of the first byte,
+// runs touching the last range appended extend it
+void diff_bytes(const uint8_t* a,
+                const uint8_t* b,
+                size_t size,
+                uintptr_t address,
+                std::vector<mnemosyne::snapshot::range>& ranges) {
+  auto mark = [&](size_t offset) {
+    uintptr_t at = address + offset;
+    if (!ranges.empty() &&
+        ranges.back().start + ranges.back().size == at) {
+      ++ranges.back().size;
+    } else {
+      ranges.push_back({at, 1});
+    }
+  };
+
+  size_t n = 0;
+#ifdef MNEMOSYNE_X86
+  // 16 bytes at a time, an equal block is skipped at once
+  for (; n + sizeof(__m128i) <= size; n += sizeof(__m128i)) {
+    for (uint32_t differ = differing_bytes_sse2(a + n, b + n); differ;
+         differ &= differ - 1) {
+      mark(n + count_trailing_zeros(differ));
+    }
+  }
+#endif
+
+  for (; n < size; ++n) {
+    if (a[n] != b[n]) {
+      mark(n);
+    }
+  }
+}
+
+// appends [start, start + size) as changed, joining the last range
+void mark_changed(uintptr_t start,
+                  size_t size,
+                  std::vector<mnemosyne::snapshot::range>& ranges) {
+  if (!ranges.empty() && ranges.back().start + ranges.back().size == start) {
+    ranges.back().size += size;
+  } else {
+    ranges.push_back({start, size});
+  }
+}
+
+// pages per unit of work when hashing or diffing in parallel
+constexpr size_t snapshot_chunk_pages = 256;
+
+std::vector<mnemosyne::snapshot::range> join_ranges(
+    std::vector<std::vector<mnemosyne::snapshot::range>>& found) {
+  std::vector<mnemosyne::snapshot::range> ranges;
+
+  for (const auto& chunk : found) {
+    for (const auto& r : chunk) {
+      mark_changed(r.start, r.size, ranges);
+    }
+  }
+
+  return ranges;
+}
+}  // namespace
+
+mnemosyne::snapshot::snapshot(uintptr_t start, size_t size)
+    : page_size(platform::page_size()) {
+  this->capture(regions::readable(start, size));
+}
+
+mnemosyne::snapshot::snapshot(const std::vector<memory_region>& regions)
+    : page_size(platform::page_size()) {
+  this->capture(regions);
+}
+
+mnemosyne::snapshot mnemosyne::snapshot::of_process() {
+  memory_region range = regions::process_range();
+  return snapshot(range.start, range.size);
+}
+
+std::vector<mnemosyne::snapshot::range> mnemosyne::snapshot::diff() const {
+  size_t chunks =
+      (this->pages.size() + snapshot_chunk_pages - 1) / snapshot_chunk_pages;
+  std::vector<std::vector<range>> found(chunks);
+
+  for_each_chunk(chunks, 0, [&](size_t chunk) {
+    size_t last =
+        std::min(this->pages.size(), (chunk + 1) * snapshot_chunk_pages);
+
+    for (size_t n = chunk * snapshot_chunk_pages; n < last; ++n) {
+      const page& p = this->pages.at(n);
+      auto live = reinterpret_cast<const uint8_t*>(p.address);
+
+      // hashed and compared in place, a page gone since counts as changed
+      std::vector<range>& ranges = found.at(chunk);
+      size_t before = ranges.size();
+      if (!platform::guarded([&]() {
+            if (hash_page(live, this->page_size) != p.hash) {
+              diff_bytes(this->bytes_of(n), live, this->page_size,
+                         p.address, ranges);
+            }
+          })) {
+        ranges.resize(before);
+        mark_changed(p.address, this->page_size, ranges);
+      }
+    }
+  });
+
+  return join_ranges(found);
+}
+
+std::vector<mnemosyne::snapshot::range> mnemosyne::snapshot::diff(
+    const snapshot& later) const {
+  std::vector<range> ranges;
+
+  size_t n = 0, m = 0;
+  while (n < this->pages.size() || m < later.pages.size()) {
+    uintptr_t a = n < this->pages.size() ? this->pages.at(n).address
+                                         : UINTPTR_MAX;
+    uintptr_t b =
+        m < later.pages.size() ? later.pages.at(m).address : UINTPTR_MAX;
+
+    if (a < b) {
+      mark_changed(a, this->page_size, ranges);
+      ++n;
+    } else if (b < a) {
+      mark_changed(b, this->page_size, ranges);
+      ++m;
+    } else {
+      if (this->pages.at(n).hash != later.pages.at(m).hash) {
+        diff_bytes(this->bytes_of(n), later.bytes_of(m), this->page_size, a,
+                   ranges);
+      }
+
+      ++n;
+      ++m;
+    }
+  }
+
+  return ranges;
+}
+
+bool mnemosyne::snapshot::read(uintptr_t address,
+                               void* destination,
+                               size_t size) const {
+  auto destination_bytes = static_cast<uint8_t*>(destination);
+
+  while (size) {
+    uintptr_t base = address & ~static_cast<uintptr_t>(this->page_size - 1);
+    auto it = std::lower_bound(
+        this->pages.begin(), this->pages.end(), base,
+        [](const page& p, uintptr_t a) { return p.address < a; });
+
+    if (it == this->pages.end() || it->address != base) {
+      return false;
+    }
+
+    size_t offset = address - base;
+    size_t count = std::min(size, this->page_size - offset);
+    memcpy(destination_bytes,
+           this->bytes_of(static_cast<size_t>(it - this->pages.begin())) +
+               offset,
+           count);
+
+    destination_bytes += count;
+    address += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+size_t mnemosyne::snapshot::size() const {
+  return this->data.size();
+}
+
+void mnemosyne::snapshot::capture(const std::vector<memory_region>& regions) {
+  const uintptr_t page_mask = ~static_cast<uintptr_t>(this->page_size - 1);
+
+  // pages are captured in address order and at most once
+  std::vector<memory_region> sorted = regions;
+  std::sort(sorted.begin(), sorted.end(),
+            [](const memory_region& a, const memory_region& b) {
+              return a.start < b.start;
+            });
+
+  uintptr_t captured = 0;
+  for (const auto& region : sorted) {
+    if (!region.size) {
+      continue;
+    }
+
+    // whole pages, read_available zero fills and reports the ones gone
+    uintptr_t start = std::max(region.start & page_mask, captured);
+    uintptr_t end =
+        ((region.start + region.size - 1) & page_mask) + this->page_size;
+    if (start >= end) {
+      continue;
+    }
+
+    captured = end;
+    size_t offset = this->data.size();
+
+    this->data.resize(offset + (end - start));
+    partial_read result = address(start).read_available(
+        this->data.data() + offset, end - start);
+
+    size_t kept = offset;
+    for (size_t n = 0; n < result.pages.size(); ++n) {
+      if (!result.pages.at(n)) {
+        continue;
+      }
+
+      if (kept != offset + n * this->page_size) {
+        memmove(this->data.data() + kept,
+                this->data.data() + offset + n * this->page_size,
+                this->page_size);
+      }
+
+      this->pages.push_back({start + n * this->page_size, 0});
+      kept += this->page_size;
+    }
+
+    this->data.resize(kept);
+  }
+
+  size_t chunks =
+      (this->pages.size() + snapshot_chunk_pages - 1) / snapshot_chunk_pages;
+  for_each_chunk(chunks, 0, [&](size_t chunk) {
+    size_t last =
+        std::min(this->pages.size(), (chunk + 1) * snapshot_chunk_pages);
+
+    for (size_t n = chunk * snapshot_chunk_pages; n < last; ++n) {
+      this->pages.at(n).hash = hash_page(this->bytes_of(n), this->page_size);
+    }
+  });
+}
+
+const uint8_t* mnemosyne::snapshot::bytes_of(size_t page) const {
+  return this->data.data() + page * this->page_size;
+}
+
+bool mnemosyne::snapshot::save(const std::string& path) const {
+  std::vector<snapshot_file::region> regions;
+  std::vector<uint64_t> page_index(this->pages.size());
+  std::vector<size_t> stored;
+  // stored pages by hash, identical pages point at the first copy
+  std::unordered_multimap<uint64_t, size_t> by_hash;
+
+  for (size_t n = 0; n < this->pages.size(); ++n) {
+    const page& p = this->pages.at(n);
+
+    if (regions.empty() ||
+        regions.back().start + regions.back().pages * this->page_size !=
+            p.address) {
+      regions.push_back({p.address, 0, n});
+    }
+    ++regions.back().pages;
+
+    auto candidates = by_hash.equal_range(p.hash);
+    auto same = std::find_if(
+        candidates.first, candidates.second, [&](const auto& candidate) {
+          return !memcmp(this->bytes_of(stored.at(candidate.second)),
+                         this->bytes_of(n), this->page_size);
+        });
+
+    if (same != candidates.second) {
+      page_index.at(n) = same->second;
+    } else {
+      page_index.at(n) = stored.size();
+      by_hash.emplace(p.hash, stored.size());
+      stored.push_back(n);
+    }
+  }
+
+  size_t tables = sizeof(snapshot_file::header) +
+                  regions.size() * sizeof(snapshot_file::region) +
+                  page_index.size() * sizeof(uint64_t);
+  size_t data_offset =
+      (tables + this->page_size - 1) / this->page_size * this->page_size;
+
+  snapshot_file::header head = {{'m', 'n', 'e', 'm', 's', 'n', 'a', 'p'},
+                                1,
+                                static_cast<uint32_t>(this->page_size),
+                                regions.size(),
+                                page_index.size(),
+                                stored.size(),
+                                data_offset};
+
+  std::ofstream file(path, std::ios::binary | std::ios::trunc);
+  file.write(reinterpret_cast<const char*>(&head), sizeof(head));
+  file.write(reinterpret_cast<const char*>(regions.data()),
+             regions.size() * sizeof(snapshot_file::region));
+  file.write(reinterpret_cast<const char*>(page_index.data()),
+             page_index.size() * sizeof(uint64_t));
+  file.write(std::vector<char>(data_offset - tables, 0).data(),
+             data_offset - tables);
+
+  for (size_t n : stored) {
+    file.write(reinterpret_cast<const char*>(this->bytes_of(n)),
+               this->page_size);
+  }
+
+  return file.good();
+}
+
+mnemosyne::snapshot_file::snapshot_file(const std::string& path)
+    : mapping(nullptr),
+      mapping_size(0),
+      head(nullptr),
+      regions(nullptr),
+      page_index(nullptr),
+#ifdef _WIN32
+      file(INVALID_HANDLE_VALUE),
+      file_mapping(nullptr) {
+#else
+      file(-1) {
+#endif
+  if (!this->map(path)) {
+    this->unmap();
+    return;
+  }
+
+  const header* head = reinterpret_cast<const header*>(this->mapping);
+  size_t tables = sizeof(header);
+
+  bool valid = this->mapping_size >= sizeof(header) &&
+               !memcmp(head->magic, "mnemsnap", sizeof(head->magic)) &&
+               head->version == 1 && head->page_size &&
+               head->region_count <= this->mapping_size / sizeof(region) &&
+               head->page_count <= this->mapping_size / sizeof(uint64_t);
+
+  if (valid) {
+    tables += head->region_count * sizeof(region) +
+              head->page_count * sizeof(uint64_t);
+    valid = tables <= head->data_offset &&
+            head->data_offset <= this->mapping_size &&
+            head->stored_count <=
+                (this->mapping_size - head->data_offset) / head->page_size;
+  }
+
+  // page_at searches the regions by start and indexes the pages of the one
+  // it finds, so they have to be sorted, apart and within the page index
+  const region* regions =
+      reinterpret_cast<const region*>(this->mapping + sizeof(header));
+  for (size_t n = 0; valid && n < head->region_count; ++n) {
+    const region& r = regions[n];
+    valid = r.pages <= head->page_count &&
+            r.first <= head->page_count - r.pages &&
+            r.pages <= (UINT64_MAX - r.start) / head->page_size;
+
+    if (valid && n) {
+      const region& previous = regions[n - 1];
+      valid = previous.start < r.start &&
+              previous.pages <= (r.start - previous.start) / head->page_size;
+    }
+  }
+
+  if (!valid) {
+    this->unmap();
+    return;
+  }
+
+  this->head = head;
+  this->regions = regions;
+  this->page_index = reinterpret_cast<const uint64_t*>(
+      this->mapping + sizeof(header) + head->region_count * sizeof(region));
+}
+
+mnemosyne::snapshot_file::~snapshot_file() {
+  this->unmap();
+}
+
+bool mnemosyne::snapshot_file::loaded() const {
+  return this->head != nullptr;
+}
+
+size_t mnemosyne::snapshot_file::captured_pages() const {
+  return this->head ? this->head->page_count : 0;
+}
+
+size_t mnemosyne::snapshot_file::stored_pages() const {
+  return this->head ? this->head->stored_count : 0;
+}
+
+bool mnemosyne::snapshot_file::in_process() const {
+  return false;
+}
+
+bool mnemosyne::snapshot_file::read(void* destination,
+                                    uintptr_t source,
+                                    size_t size) {
+  auto bytes = static_cast<uint8_t*>(destination);
+
+  while (size) {
+    const uint8_t* page = this->page_at(source);
+    if (!page) {
+      return false;
+    }
+
+    size_t offset = source % this->head->page_size;
+    size_t count = std::min<size_t>(size, this->head->page_size - offset);
+    memcpy(bytes, page + offset, count);
+
+    bytes += count;
+    source += count;
+    size -= count;
+  }
+
+  return true;
+}
+
+bool mnemosyne::snapshot_file::write(uintptr_t, const void*, size_t) {
+  return false;
+}
+
+std::vector<mnemosyne::memory_region> mnemosyne::snapshot_file::readable(
+    uintptr_t start,
+    size_t size) {
+  std::vector<memory_region> readable;
+  uintptr_t end = size > UINTPTR_MAX - start ? UINTPTR_MAX : start + size;
+
+  for (uint64_t n = 0; this->head && n < this->head->region_count; ++n) {
+    uintptr_t low = std::max<uintptr_t>(this->regions[n].start, start);
+    uintptr_t high = std::min<uintptr_t>(
+        this->regions[n].start +
+            this->regions[n].pages * this->head->page_size,
+        end);
+
+    if (low < high) {
+      readable.push_back({low, high - low, true, false, false});
+    }
+  }
+
+  return readable;
+}
+
+const uint8_t* mnemosyne::snapshot_file::in_place(uintptr_t address,
+                                                  size_t size) {
+  const uint8_t* first = this->page_at(address);
+  if (!first || !size) {
+    return nullptr;
+  }
+
+  // identical pages stored once break the run, those ranges are copied
+  const size_t page_size = this->head->page_size;
+  const uintptr_t first_page = address - address % page_size;
+
+  for (uintptr_t page = first_page + page_size; page - address < size;
+       page += page_size) {
+    if (this->page_at(page) != first + (page - first_page)) {
+      return nullptr;
+    }
+  }
+
+  return first + (address - first_page);
+}
+
+#ifdef _WIN32
+bool mnemosyne::snapshot_file::map(const std::string& path) {
+  this->file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ,
+                           nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL,
+                           nullptr);
+  LARGE_INTEGER size = {0};
+
+  if (this->file == INVALID_HANDLE_VALUE ||
+      !GetFileSizeEx(this->file, &size) || !size.QuadPart) {
+    return false;
+  }
+
+  this->file_mapping =
+      CreateFileMappingA(this->file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+  if (!this->file_mapping) {
+    return false;
+  }
+
+  this->mapping = static_cast<const uint8_t*>(
+      MapViewOfFile(this->file_mapping, FILE_MAP_READ, 0, 0, 0));
+  this->mapping_size = static_cast<size_t>(size.QuadPart);
+
+  return this->mapping != nullptr;
+}
+
+void mnemosyne::snapshot_file::unmap() {
+  if (this->mapping) {
+    UnmapViewOfFile(this->mapping);
+  }
+
+  if (this->file_mapping) {
+    CloseHandle(this->file_mapping);
+  }
+
+  if (this->file != INVALID_HANDLE_VALUE) {
+    CloseHandle(this->file);
+  }
+
+  this->mapping = nullptr;
+  this->file_mapping = nullptr;
+  this->file = INVALID_HANDLE_VALUE;
+  this->head = nullptr;
+}
+#else
+bool mnemosyne::snapshot_file::map(const std::string& path) {
+  this->file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  off_t size = this->file < 0 ? 0 : lseek(this->file, 0, SEEK_END);
+
+  if (size <= 0) {
+    return false;
+  }
+
+  void* mapping = mmap(nullptr, static_cast<size_t>(size), PROT_READ,
+                       MAP_PRIVATE, this->file, 0);
+  if (mapping == MAP_FAILED) {
+    return false;
+  }
+
+  this->mapping = static_cast<const uint8_t*>(mapping);
+  this->mapping_size = static_cast<size_t>(size);
+
+  return true;
+}
+
+void mnemosyne::snapshot_file::unmap() {
+  if (this->mapping) {
+    munmap(const_cast<uint8_t*>(this->mapping), this->mapping_size);
+  }
+
+  if (this->file >= 0) {
+    close(this->file);
+  }
+
+  this->mapping = nullptr;
+  this->file = -1;
+  this->head = nullptr;
+}
+#endif
+
+const uint8_t* mnemosyne::snapshot_file::page_at(uintptr_t address) const {
+  if (!this->head) {
+    return nullptr;
+  }
+
+  const region* end = this->regions + this->head->region_count;
+  const region* it = std::upper_bound(
+      this->regions, end, address,
+      [](uintptr_t a, const region& r) { return a < r.start; });
+
+  if (it == this->regions) {
+    return nullptr;
+  }
+
+  --it;
+  uint64_t page = (address - it->start) / this->head->page_size;
+  if (page >= it->pages) {
+    return nullptr;
+  }
+
+  uint64_t stored = this->page_index[it->first + page];
+  if (stored >= this->head->stored_count) {
+    return nullptr;
+  }
+
+  return this->mapping + this->head->data_offset +
+         stored * this->head->page_size;
+}
+
+namespace {
+#ifndef _WIN32
+// bit 55 of a pagemap entry, set once the page is written after the bits
+// were cleared
+constexpr uint64_t soft_dirty_bit = uint64_t(1) << 55;
+
+// held by the dirty_pages using the soft dirty bits, clearing them is
+// process wide
+std::atomic<bool> soft_dirty_taken(false);
+
+bool clear_soft_dirty() {
+  int32_t file = open("/proc/self/clear_refs", O_WRONLY | O_CLOEXEC);
+  if (file < 0) {
+    return false;
+  }
+
+  bool cleared = ::write(file, "4", 1) == 1;
+  close(file);
+
+  return cleared;
+}
+
+bool pagemap_entry(int32_t pagemap, uintptr_t address, uint64_t& entry) {
+  off_t offset =
+      static_cast<off_t>(address / mnemosyne::platform::page_size()) *
+      sizeof(uint64_t);
+  return pread(pagemap, &entry, sizeof(entry), offset) == sizeof(entry);
+}
+
+// kernels without CONFIG_MEM_SOFT_DIRTY report the bit as always clear, so
+// a page is written after clearing and must show up. only called while
+// holding soft_dirty_taken
+bool soft_dirty_supported() {
+  static const bool supported = []() {
+    const size_t page_size = mnemosyne::platform::page_size();
+    void* probe = mmap(nullptr, page_size, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    int32_t pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+
+    bool result = false;
+    if (probe != MAP_FAILED && pagemap >= 0) {
+      auto at = static_cast<volatile uint8_t*>(probe);
+      auto address = reinterpret_cast<uintptr_t>(probe);
+      uint64_t before = 0, after = 0;
+
+      *at = 1;
+      if (clear_soft_dirty() && pagemap_entry(pagemap, address, before)) {
+        *at = 2;
+        result = pagemap_entry(pagemap, address, after) &&
+                 !(before & soft_dirty_bit) && (after & soft_dirty_bit);
+      }
+    }
+
+    if (pagemap >= 0) {
+      close(pagemap);
+    }
+
+    if (probe != MAP_FAILED) {
+      munmap(probe, page_size);
+    }
+
+    return result;
+  }();
+
+  return supported;
+}
+#endif
+}  // namespace
+
+mnemosyne::dirty_pages::dirty_pages(uintptr_t start,
+                                    size_t size,
+                                    bool prefer_soft_dirty)
+    : start(start), size(size), kernel(false), collected(false) {
+#ifndef _WIN32
+  if (prefer_soft_dirty && !soft_dirty_taken.exchange(true)) {
+    this->kernel = soft_dirty_supported();
+
+    if (!this->kernel) {
+      soft_dirty_taken = false;
+    }
+  }
+#else
+  static_cast<void>(prefer_soft_dirty);
+#endif
+}
+
+mnemosyne::dirty_pages::~dirty_pages() {
+#ifndef _WIN32
+  if (this->kernel) {
+    soft_dirty_taken = false;
+  }
+#endif
+}
+
+std::vector<mnemosyne::snapshot::range> mnemosyne::dirty_pages::collect() {
+  const size_t page_size = platform::page_size();
+  const uintptr_t page_mask = ~static_cast<uintptr_t>(page_size - 1);
+
+  std::vector<page> current;
+  for (const auto& region : regions::readable(this->start, this->size)) {
+    if (!region.size) {
+      continue;
+    }
+
+    uintptr_t first = region.start & page_mask;
+    size_t count =
+        (((region.start + region.size - 1) & page_mask) - first) / page_size +
+        1;
+
+    for (size_t n = 0; n < count; ++n) {
+      uintptr_t address = first + n * page_size;
+
+      if (current.empty() || current.back().address < address) {
+        current.push_back({address, 0});
+      }
+    }
+  }
+
+  std::vector<bool> written;
+  if (this->kernel) {
+    // every page counts as written if the bits could not be read
+    if (!this->read_soft_dirty(current, written)) {
+      written.assign(current.size(), true);
+    }
+  } else {
+    // hashed in place, a page gone since the query counts as unmapped
+    std::vector<char> gone(current.size(), false);
+    size_t chunks =
+        (current.size() + snapshot_chunk_pages - 1) / snapshot_chunk_pages;
+
+    for_each_chunk(chunks, 0, [&](size_t chunk) {
+      size_t last =
+          std::min(current.size(), (chunk + 1) * snapshot_chunk_pages);
+
+      for (size_t n = chunk * snapshot_chunk_pages; n < last; ++n) {
+        page& p = current.at(n);
+
+        gone.at(n) = !platform::guarded([&]() {
+          p.hash = hash_page(reinterpret_cast<const uint8_t*>(p.address),
+                             page_size);
+        });
+      }
+    });
+
+    size_t kept = 0;
+    for (size_t n = 0; n < current.size(); ++n) {
+      if (!gone.at(n)) {
+        current.at(kept++) = current.at(n);
+      }
+    }
+
+    current.resize(kept);
+  }
+
+  // both lists are in address order, pages only one of them holds were
+  // mapped or unmapped since
+  std::vector<snapshot::range> ranges;
+  size_t n = 0;
+  for (size_t m = 0; m < current.size(); ++m) {
+    const page& now = current.at(m);
+
+    for (; n < this->pages.size() && this->pages.at(n).address < now.address;
+         ++n) {
+      mark_changed(this->pages.at(n).address, page_size, ranges);
+    }
+
+    bool known =
+        n < this->pages.size() && this->pages.at(n).address == now.address;
+    bool dirty = !this->collected || !known ||
+                 (this->kernel ? written.at(m)
+                               : this->pages.at(n).hash != now.hash);
+
+    if (known) {
+      ++n;
+    }
+
+    if (dirty) {
+      mark_changed(now.address, page_size, ranges);
+    }
+  }
+
+  for (; n < this->pages.size(); ++n) {
+    mark_changed(this->pages.at(n).address, page_size, ranges);
+  }
+
+#ifndef _WIN32
+  if (this->kernel) {
+    clear_soft_dirty();
+  }
+#endif
+
+  this->pages = std::move(current);
+  this->collected = true;
+
+  return ranges;
+}
+
+bool mnemosyne::dirty_pages::soft_dirty() const {
+  return this->kernel;
+}
+
+bool mnemosyne::dirty_pages::read_soft_dirty(const std::vector<page>& current,
+                                             std::vector<bool>& written) const {
+#ifdef _WIN32
+  static_cast<void>(current);
+  static_cast<void>(written);
+  return false;
+#else
+  const size_t page_size = platform::page_size();
+  int32_t pagemap = open("/proc/self/pagemap", O_RDONLY | O_CLOEXEC);
+  if (pagemap < 0) {
+    return false;
+  }
+
+  // one read per run of adjacent pages, up to a page of entries at a time
+  written.assign(current.size(), false);
+  std::vector<uint64_t> entries(page_size / sizeof(uint64_t));
+  bool result = true;
+
+  for (size_t n = 0; n < current.size() && result;) {
+    size_t run = 1;
+    while (n + run < current.size() && run < entries.size() &&
+           current.at(n + run).address ==
+               current.at(n).address + run * page_size) {
+      ++run;
+    }
+
+    off_t offset =
+        static_cast<off_t>(current.at(n).address / page_size) *
+        sizeof(uint64_t);
+    ssize_t bytes = run * sizeof(uint64_t);
+
+    result = pread(pagemap, entries.data(), bytes, offset) == bytes;
+    for (size_t m = 0; result && m < run; ++m) {
+      written.at(n + m) = (entries.at(m) & soft_dirty_bit) != 0;
+    }
+
+    n += run;
+  }
+
+  close(pagemap);
+  return result;
+#endif
+}
+
+mnemosyne::read_plan::read_plan(size_t max_gap)
+    : source(nullptr), max_gap(max_gap), planned(false) {}
+
+mnemosyne::read_plan::read_plan(memory_source& source, size_t max_gap)
+    : source(&source), max_gap(max_gap), planned(false) {}
+
+size_t mnemosyne::read_plan::add(uintptr_t address,
+                                 void* destination,
+                                 size_t size) {
+  this->entries.push_back({address, destination, size, 0, 0});
+  this->planned = false;
+
+  return this->entries.size() - 1;
+}
+
+size_t mnemosyne::read_plan::execute() {
+  if (!this->planned) {
+    this->plan();
+  }
+
+  if (this->source && !this->source->in_process()) {
+    this->source->read_many(this->spans, this->span_batch);
+  } else {
+    for (size_t n = 0; n < this->spans.size(); ++n) {
+      this->span_batch.results[n] = this->read_span(n);
+    }
+  }
+
+  size_t succeeded = 0;
+  for (size_t n = 0; n < this->entries.size(); ++n) {
+    const entry& e = this->entries[n];
+
+    if (this->span_batch.results[e.span]) {
+      memcpy(e.destination, this->staging.data() + e.offset, e.size);
+      this->results[n] = true;
+    } else {
+      // a merged copy fails as a whole, the read may still succeed alone
+      this->results[n] =
+          this->source ? this->source->read(e.destination, e.address, e.size)
+                       : platform::read(e.destination,
+                                        reinterpret_cast<void*>(e.address),
+                                        e.size);
+    }
+
+    succeeded += this->results[n];
+  }
+
+  return succeeded;
+}
+
+bool mnemosyne::read_plan::succeeded(size_t index) const {
+  return this->results.at(index);
+}
+
+size_t mnemosyne::read_plan::size() const {
+  return this->entries.size();
+}
+
+void mnemosyne::read_plan::clear() {
+  this->entries.clear();
+  this->spans.clear();
+  this->staging.clear();
+  this->span_batch.results.clear();
+  this->results.clear();
+  this->planned = false;
+}
+
+void mnemosyne::read_plan::plan() {
+  std::vector<size_t> order(this->entries.size());
+  for (size_t n = 0; n < order.size(); ++n) {
+    order.at(n) = n;
+  }
+
+  std::sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+    return this->entries.at(a).address < this->entries.at(b).address;
+  });
+
+  // spans are built with offsets into staging, the buffers are filled in
+  // once staging has its final size
+  this->spans.clear();
+  size_t staged = 0;
+
+  for (size_t n : order) {
+    entry& e = this->entries.at(n);
+    uintptr_t end = e.address + e.size;
+
+    if (!this->spans.empty()) {
+      memory_source::request& last = this->spans.back();
+      uintptr_t last_end = last.address + last.size;
+
+      if (e.address <= last_end || e.address - last_end <= this->max_gap) {
+        if (end > last_end) {
+          staged += end - last_end;
+          last.size = end - last.address;
+        }
+
+        e.span = this->spans.size() - 1;
+        e.offset = reinterpret_cast<uintptr_t>(last.buffer) +
+                   (e.address - last.address);
+        continue;
+      }
+    }
+
+    this->spans.push_back(
+        {e.address, reinterpret_cast<void*>(staged), e.size});
+    e.span = this->spans.size() - 1;
+    e.offset = staged;
+    staged += e.size;
+  }
+
+  this->staging.assign(staged, 0);
+  for (auto& span : this->spans) {
+    span.buffer =
+        this->staging.data() + reinterpret_cast<uintptr_t>(span.buffer);
+  }
+
+  this->span_batch.results.assign(this->spans.size(), false);
+  this->results.assign(this->entries.size(), false);
+  this->planned = true;
+}
+
+bool mnemosyne::read_plan::read_span(size_t span) {
+  const memory_source::request& r = this->spans[span];
+
+  return this->source
+             ? this->source->read(r.buffer, r.address, r.size)
+             : platform::read(r.buffer, reinterpret_cast<void*>(r.address),
+                              r.size);
+}
+
+mnemosyne::memory_patch::memory_patch(const address& ptr,
+                                      const std::vector<uint8_t>& bytes)
+    : ptr(ptr), replace_bytes(bytes) {
+  this->retain_bytes = this->ptr.read_memory(bytes.size());
+}
+
+bool mnemosyne::memory_patch::edit() {
+  return this->ptr.write_memory(this->replace_bytes);
+}
+
+bool mnemosyne::memory_patch::revert() {
+  return this->ptr.write_memory(this->retain_bytes);
+}
+
+size_t mnemosyne::memory_patch::edit(write_batch& batch) {
+  return batch.add(this->ptr, this->replace_bytes);
+}
+
+size_t mnemosyne::memory_patch::revert(write_batch& batch) {
+  return batch.add(this->ptr, this->retain_bytes);
+}
+
+mnemosyne::memory_patch::memory_patch() {}
+
+namespace {
+// a rel32 reaches 2 GiB either way, kept clear of the limit
+constexpr uintptr_t near_reach = 0x7ff00000;
+
+bool within_reach(uintptr_t from, uintptr_t to) {
+  return (from > to ? from - to : to - from) < near_reach;
+}
+
+// free gaps of the address space as [start, end), in address order
+std::vector<std::pair<uintptr_t, uintptr_t>> free_gaps(uintptr_t low,
+                                                       uintptr_t high) {
+  std::vector<std::pair<uintptr_t, uintptr_t>> gaps;
+
+#ifdef _WIN32
+  MEMORY_BASIC_INFORMATION info = {};
+  for (uintptr_t at = low;
+       at < high && VirtualQuery(reinterpret_cast<void*>(at), &info,
+                                 sizeof(info)) == sizeof(info);
+       at = reinterpret_cast<uintptr_t>(info.BaseAddress) + info.RegionSize) {
+    if (info.State == MEM_FREE) {
+      gaps.emplace_back(reinterpret_cast<uintptr_t>(info.BaseAddress),
+                        reinterpret_cast<uintptr_t>(info.BaseAddress) +
+                            info.RegionSize);
+    }
+  }
+#else
+  uintptr_t gap = low;
+  for (const auto& map : parse_maps()) {
+    if (map.start > gap) {
+      gaps.emplace_back(gap, std::min(map.start, high));
+    }
+
+    gap = std::max(gap, map.start + map.size);
+    if (gap >= high) {
+      break;
+    }
+  }
+
+  if (gap < high) {
+    gaps.emplace_back(gap, high);
+  }
+#endif
+
+  return gaps;
+}
+
+// maps size executable bytes in the free gap closest to target, so the
+// whole mapping is within reach of it. 0 if there is no room
+uintptr_t map_near(uintptr_t target, size_t size) {
+#ifdef _WIN32
+  // allocations start on the allocation granularity
+  SYSTEM_INFO system = {};
+  GetSystemInfo(&system);
+  const uintptr_t alignment = system.dwAllocationGranularity;
+  const uintptr_t lowest =
+      reinterpret_cast<uintptr_t>(system.lpMinimumApplicationAddress);
+#else
+  const uintptr_t alignment = mnemosyne::platform::page_size();
+  // below this the kernel refuses mappings
+  const uintptr_t lowest = 0x10000;
+#endif
+  const uintptr_t mask = ~(alignment - 1);
+
+  uintptr_t low = target > near_reach ? target - near_reach : 0;
+  uintptr_t high =
+      target < UINTPTR_MAX - near_reach ? target + near_reach : UINTPTR_MAX;
+
+  std::vector<uintptr_t> candidates;
+  for (const auto& gap : free_gaps(std::max(low, lowest), high)) {
+    uintptr_t first = (gap.first + alignment - 1) & mask;
+    if (gap.second <= first || gap.second - first < size) {
+      continue;
+    }
+
+    uintptr_t last = (gap.second - size) & mask;
+    uintptr_t nearest = std::min(std::max(target & mask, first), last);
+
+    if (within_reach(nearest, target) && within_reach(nearest + size, target)) {
+      candidates.push_back(nearest);
+    }
+  }
+
+  std::sort(candidates.begin(), candidates.end(),
+            [&](uintptr_t a, uintptr_t b) {
+              return (a > target ? a - target : target - a) <
+                     (b > target ? b - target : target - b);
+            });
+
+  for (uintptr_t candidate : candidates) {
+#ifdef _WIN32
+    if (VirtualAlloc(reinterpret_cast<void*>(candidate), size,
+                     MEM_RESERVE | MEM_COMMIT, PAGE_EXECUTE_READ)) {
+      return candidate;
+    }
+#else
+    // kernels before 4.17 take MAP_FIXED_NOREPLACE as a hint
+    void* mapping = mmap(reinterpret_cast<void*>(candidate), size,
+                         PROT_READ | PROT_EXEC,
+                         MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE,
+                         -1, 0);
+
+    if (mapping == reinterpret_cast<void*>(candidate)) {
+      return candidate;
+    }
+
+    if (mapping != MAP_FAILED) {
+      munmap(mapping, size);
+    }
+#endif
+  }
+
+  return 0;
+}
+
+void unmap_slab(uintptr_t start, size_t size) {
+#ifdef _WIN32
+  static_cast<void>(size);
+  VirtualFree(reinterpret_cast<void*>(start), 0, MEM_RELEASE);
+#else
+  munmap(reinterpret_cast<void*>(start), size);
+#endif
+}
+}  // namespace
+
+mnemosyne::code_arena::code_arena(size_t slab_size) {
+  const size_t page_size = platform::page_size();
+  this->slab_size = std::max(
+      page_size, (slab_size + page_size - 1) & ~(page_size - 1));
+}
+
+mnemosyne::code_arena::~code_arena() {
+  this->release_all();
+}
+
+mnemosyne::code_arena& mnemosyne::code_arena::shared() {
+  // never destroyed, hooks may run until the process is gone
+  static code_arena* arena = new code_arena();
+  return *arena;
+}
+
+uintptr_t mnemosyne::code_arena::allocate(uintptr_t target, size_t size) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  size = (size + slot_alignment - 1) & ~(slot_alignment - 1);
+
+  if (!size) {
+    return 0;
+  }
+
+  for (auto& s : this->slabs) {
+    if (!within_reach(s.start, target) ||
+        !within_reach(s.start + s.size, target)) {
+      continue;
+    }
+
+    // first fit
+    for (auto it = s.free.begin(); it != s.free.end(); ++it) {
+      if (it->size < size) {
+        continue;
+      }
+
+      uintptr_t slot = s.start + it->offset;
+      it->offset += size;
+      it->size -= size;
+      if (!it->size) {
+        s.free.erase(it);
+      }
+
+      this->slots[slot] = size;
+      return slot;
+    }
+  }
+
+  // slots larger than a slab get a slab of their own
+  const size_t mapped =
+      (size + this->slab_size - 1) / this->slab_size * this->slab_size;
+  uintptr_t start = map_near(target, mapped);
+  if (!start) {
+    return 0;
+  }
+
+  slab s = {start, mapped, {}};
+  if (size < mapped) {
+    s.free.push_back({size, mapped - size});
+  }
+
+  this->slabs.push_back(std::move(s));
+  this->slots[start] = size;
+
+  return start;
+}
+
+bool mnemosyne::code_arena::write(uintptr_t slot,
+                                  const void* code,
+                                  size_t size) {
+  // held throughout, a writer must not make a page executable again while
+  // another one still copies into it
+  std::lock_guard<std::mutex> lock(this->mutex);
+  auto it = this->slots.find(slot);
+
+  if (it == this->slots.end() || size > it->second) {
+    return false;
+  }
+
+  if (!size) {
+    return true;
+  }
+
+  // the pages of the slot are never writable and executable at once
+  uint32_t old = 0;
+  if (!change_protection(slot, size, native_protection(true, true, false),
+                         old)) {
+    return false;
+  }
+
+  memcpy(reinterpret_cast<void*>(slot), code, size);
+  bool restored = change_protection(
+      slot, size, native_protection(true, false, true), old);
+  platform::invalidate(reinterpret_cast<void*>(slot), size);
+
+#ifdef _WIN32
+  FlushInstructionCache(GetCurrentProcess(), reinterpret_cast<void*>(slot),
+                        size);
+#else
+  __builtin___clear_cache(reinterpret_cast<char*>(slot),
+                          reinterpret_cast<char*>(slot + size));
+#endif
+
+  return restored;
+}
+
+void mnemosyne::code_arena::release(uintptr_t slot) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  auto it = this->slots.find(slot);
+  if (it == this->slots.end()) {
+    return;
+  }
+
+  const size_t size = it->second;
+  this->slots.erase(it);
+
+  for (auto& s : this->slabs) {
+    if (slot - s.start >= s.size) {
+      continue;
+    }
+
+    // kept sorted and joined with the free spans either side
+    span released = {slot - s.start, size};
+    auto next = std::lower_bound(
+        s.free.begin(), s.free.end(), released.offset,
+        [](const span& f, size_t offset) { return f.offset < offset; });
+
+    if (next != s.free.end() &&
+        released.offset + released.size == next->offset) {
+      released.size += next->size;
+      next = s.free.erase(next);
+    }
+
+    if (next != s.free.begin() &&
+        (next - 1)->offset + (next - 1)->size == released.offset) {
+      (next - 1)->size += released.size;
+    } else {
+      s.free.insert(next, released);
+    }
+
+    return;
+  }
+}
+
+void mnemosyne::code_arena::release_all() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  for (const auto& s : this->slabs) {
+    unmap_slab(s.start, s.size);
+  }
+
+  this->slabs.clear();
+  this->slots.clear();
+}
+
+size_t mnemosyne::code_arena::used() const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  size_t bytes = 0;
+  for (const auto& slot : this->slots) {
+    bytes += slot.second;
+  }
+
+  return bytes;
+}
+
+size_t mnemosyne::code_arena::reserved() const {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  size_t bytes = 0;
+  for (const auto& s : this->slabs) {
+    bytes += s.size;
+  }
+
+  return bytes;
+}
+
+#ifdef MNEMOSYNE_INLINE_HOOK
+namespace {
+// what relocating an instruction of a hooked prologue needs to know about it
+struct decoded_instruction {
+  enum class branch { none, jump, conditional, call, loop };
+
+  size_t length;
+  // offset of the first opcode byte, after the prefixes
+  size_t opcode;
+  // offset of a rip relative disp32, 0 if there is none
+  size_t displacement;
+  // offset and size of the displacement of a relative branch
+  size_t relative;
+  size_t relative_size;
+  branch kind;
+  uint8_t condition;
+  // execution does not fall through to the next instruction
+  bool ends;
+};
+
+bool one_byte_has_modrm(uint8_t op) {
+  return (op < 0x40 && (op & 7) < 4) || op == 0x63 || op == 0x69 ||
+         op == 0x6b || (op >= 0x80 && op <= 0x8f) || op == 0xc0 ||
+         op == 0xc1 || op == 0xc6 || op == 0xc7 || (op >= 0xd0 && op <= 0xd3) ||
+         (op >= 0xd8 && op <= 0xdf) || op == 0xf6 || op == 0xf7 ||
+         op == 0xfe || op == 0xff;
+}
+
+bool invalid_in_64_bit(uint8_t op) {
+  static const uint8_t invalid[] = {0x06, 0x07, 0x0e, 0x16, 0x17, 0x1e, 0x1f,
+                                    0x27, 0x2f, 0x37, 0x3f, 0x60, 0x61, 0x82,
+                                    0x9a, 0xce, 0xd4, 0xd5, 0xd6, 0xea};
+  return std::find(std::begin(invalid), std::end(invalid), op) !=
+         std::end(invalid);
+}
+
+// length decoder for 64-bit code, enough of the instruction set for
+// function prologues. false for instructions it does not know
+bool decode_x64(const uint8_t* code, decoded_instruction& out) {
+  out = {0, 0, 0, 0, 0, decoded_instruction::branch::none, 0, false};
+
+  size_t n = 0;
+  bool operand16 = false, address32 = false, rex_w = false;
+  for (;; ++n) {
+    uint8_t b = code[n];
+
+    if (b == 0x66) {
+      operand16 = true;
+    } else if (b == 0x67) {
+      address32 = true;
+    } else if (b != 0xf0 && b != 0xf2 && b != 0xf3 && b != 0x2e &&
+               b != 0x36 && b != 0x3e && b != 0x26 && b != 0x64 &&
+               b != 0x65) {
+      break;
+    }
+
+    if (n == 14) {
+      return false;
+    }
+  }
+
+  if ((code[n] & 0xf0) == 0x40) {
+    rex_w = (code[n] & 8) != 0;
+    ++n;
+  }
+
+  out.opcode = n;
+  uint8_t op = code[n++];
+  // 0 for the one byte opcodes, 1 for 0f, 2 for 0f 38 and 3 for 0f 3a
+  size_t map = 0;
+  // operand size immediate, 16 bits with the 0x66 prefix
+  const size_t z = operand16 ? 2 : 4;
+  bool modrm = false;
+  size_t immediate = 0;
+
+  if (op == 0xc4 || op == 0xc5 || op == 0x62) {
+    // vex and evex, the map decides the immediate
+    map = 1;
+    if (op == 0xc4) {
+      map = code[n] & 0x1f;
+      n += 2;
+    } else if (op == 0xc5) {
+      n += 1;
+    } else {
+      map = code[n] & 0x07;
+      n += 3;
+    }
+
+    op = code[n++];
+    modrm = true;
+
+    if (map == 3 ||
+        (map == 1 && ((op >= 0x70 && op <= 0x73) || op == 0xc2 ||
+                      op == 0xc4 || op == 0xc5 || op == 0xc6))) {
+      immediate = 1;
+    } else if (map != 1 && map != 2) {
+      return false;
+    }
+  } else if (op == 0x0f) {
+    op = code[n++];
+    map = 1;
+
+    if (op == 0x38 || op == 0x3a) {
+      map = op == 0x38 ? 2 : 3;
+      op = code[n++];
+      modrm = true;
+      immediate = map == 3 ? 1 : 0;
+    } else if (op >= 0x80 && op <= 0x8f) {
+      out.kind = decoded_instruction::branch::conditional;
+      out.condition = op & 0x0f;
+      out.relative_size = 4;
+    } else {
+      modrm = !(op == 0x05 || op == 0x06 || op == 0x07 || op == 0x08 ||
+                op == 0x09 || op == 0x0b || op == 0x0e ||
+                (op >= 0x30 && op <= 0x37) || op == 0x77 || op == 0xa0 ||
+                op == 0xa1 || op == 0xa2 || op == 0xa8 || op == 0xa9 ||
+                op == 0xaa || (op >= 0xc8 && op <= 0xcf));
+      immediate = (op >= 0x70 && op <= 0x73) || op == 0xa4 || op == 0xac ||
+                          op == 0xba || op == 0xc2 || op == 0xc4 ||
+                          op == 0xc5 || op == 0xc6
+                      ? 1
+                      : 0;
+      out.ends = op == 0x0b;
+    }
+  } else {
+    if (invalid_in_64_bit(op)) {
+      return false;
+    }
+
+    modrm = one_byte_has_modrm(op);
+
+    if (op < 0x40 && (op & 7) == 4) {
+      immediate = 1;
+    } else if (op < 0x40 && (op & 7) == 5) {
+      immediate = z;
+    } else if (op == 0x68 || op == 0x69 || op == 0x81 || op == 0xa9 ||
+               op == 0xc7) {
+      immediate = z;
+    } else if (op == 0x6a || op == 0x6b || op == 0x80 || op == 0x83 ||
+               op == 0xa8 || op == 0xc0 || op == 0xc1 || op == 0xc6 ||
+               op == 0xcd || (op >= 0xe4 && op <= 0xe7) ||
+               (op >= 0xb0 && op <= 0xb7)) {
+      immediate = 1;
+    } else if (op >= 0xb8 && op <= 0xbf) {
+      immediate = rex_w ? 8 : z;
+    } else if (op == 0xc2 || op == 0xca) {
+      immediate = 2;
+    } else if (op == 0xc8) {
+      immediate = 3;
+    } else if (op >= 0xa0 && op <= 0xa3) {
+      immediate = address32 ? 4 : 8;
+    } else if (op >= 0x70 && op <= 0x7f) {
+      out.kind = decoded_instruction::branch::conditional;
+      out.condition = op & 0x0f;
+      out.relative_size = 1;
+    } else if (op >= 0xe0 && op <= 0xe3) {
+      out.kind = decoded_instruction::branch::loop;
+      out.relative_size = 1;
+    } else if (op == 0xeb || op == 0xe9) {
+      out.kind = decoded_instruction::branch::jump;
+      out.relative_size = op == 0xeb ? 1 : 4;
+    } else if (op == 0xe8) {
+      out.kind = decoded_instruction::branch::call;
+      out.relative_size = 4;
+    }
+
+    out.ends = op == 0xc3 || op == 0xc2 || op == 0xcb || op == 0xca ||
+               op == 0xcc || op == 0xcf || op == 0xeb || op == 0xe9;
+  }
+
+  if (modrm) {
+    const uint8_t m = code[n++];
+    const uint8_t mod = m >> 6, reg = (m >> 3) & 7, rm = m & 7;
+    size_t displacement = 0;
+
+    if (mod != 3) {
+      if (rm == 4 && mod == 0 && (code[n] & 7) == 5) {
+        displacement = 4;
+      } else if (rm == 5 && mod == 0) {
+        out.displacement = n;
+        displacement = 4;
+      }
+
+      if (rm == 4) {
+        ++n;
+      }
+
+      displacement = mod == 1 ? 1 : mod == 2 ? 4 : displacement;
+    }
+
+    n += displacement;
+
+    // test has an immediate the rest of its group does not
+    if (map == 0 && (op == 0xf6 || op == 0xf7) && reg < 2) {
+      immediate = op == 0xf6 ? 1 : z;
+    }
+
+    // indirect jmp, the rip relative kind is relocated like any operand
+    if (map == 0 && op == 0xff && (reg == 4 || reg == 5)) {
+      out.ends = true;
+    }
+  }
+
+  if (out.relative_size) {
+    out.relative = n;
+    n += out.relative_size;
+  }
+
+  n += immediate;
+  out.length = n;
+
+  return n <= 15;
+}
+
+// jmp [rip], followed by the absolute address to jump to
+constexpr size_t absolute_jump_size = 14;
+
+void append_absolute_jump(std::vector<uint8_t>& code, uintptr_t to) {
+  const uint8_t jump[] = {0xff, 0x25, 0x00, 0x00, 0x00, 0x00};
+  code.insert(code.end(), std::begin(jump), std::end(jump));
+
+  for (size_t n = 0; n < sizeof(uint64_t); ++n) {
+    code.push_back(static_cast<uint8_t>(static_cast<uint64_t>(to) >> (8 * n)));
+  }
+}
+
+bool fits_rel32(int64_t value) {
+  return value >= INT32_MIN && value <= INT32_MAX;
+}
+
+void put_rel32(uint8_t* at, int64_t value) {
+  int32_t rel = static_cast<int32_t>(value);
+  memcpy(at, &rel, sizeof(rel));
+}
+
+// copies whole instructions from target into code, meant to run at
+// destination, until at least minimum bytes are covered, then jumps back.
+// rip relative operands and branches are fixed for their new address and
+// short branches widened. the instruction boundaries are recorded as pairs
+// of offsets in target and in code
+bool relocate_prologue(uintptr_t target,
+                       size_t minimum,
+                       uintptr_t destination,
+                       std::vector<uint8_t>& code,
+                       size_t& covered,
+                       std::vector<std::pair<uint8_t, uint8_t>>& boundaries) {
+  std::vector<uintptr_t> branches;
+  covered = 0;
+
+  while (covered < minimum) {
+    auto source = reinterpret_cast<const uint8_t*>(target + covered);
+    decoded_instruction instruction;
+
+    // a breakpoint at the start is likely a debugger's
+    if (!decode_x64(source, instruction) ||
+        instruction.kind == decoded_instruction::branch::loop ||
+        (source[instruction.opcode] == 0xcc && instruction.length == 1)) {
+      return false;
+    }
+
+    boundaries.emplace_back(static_cast<uint8_t>(covered),
+                            static_cast<uint8_t>(code.size()));
+    const uintptr_t next = target + covered + instruction.length;
+    const uintptr_t at = destination + code.size();
+
+    if (instruction.kind != decoded_instruction::branch::none) {
+      int64_t rel = instruction.relative_size == 1
+                        ? static_cast<int8_t>(source[instruction.relative])
+                        : [&]() {
+                            int32_t value = 0;
+                            memcpy(&value, source + instruction.relative,
+                                   sizeof(value));
+                            return static_cast<int64_t>(value);
+                          }();
+      uintptr_t to = next + rel;
+      branches.push_back(to);
+
+      // prefixes are kept, the branch itself is rewritten with a rel32
+      code.insert(code.end(), source, source + instruction.opcode);
+      if (instruction.kind == decoded_instruction::branch::conditional) {
+        code.push_back(0x0f);
+        code.push_back(static_cast<uint8_t>(0x80 | instruction.condition));
+      } else {
+        code.push_back(
+            instruction.kind == decoded_instruction::branch::call ? 0xe8
+                                                                  : 0xe9);
+      }
+
+      code.insert(code.end(), 4, 0);
+      int64_t widened = static_cast<int64_t>(to - (destination + code.size()));
+      if (!fits_rel32(widened)) {
+        return false;
+      }
+
+      put_rel32(&code.back() - 3, widened);
+    } else {
+      code.insert(code.end(), source, source + instruction.length);
+
+      if (instruction.displacement) {
+        int32_t displacement = 0;
+        memcpy(&displacement, source + instruction.displacement,
+               sizeof(displacement));
+
+        int64_t moved = displacement + static_cast<int64_t>(next) -
+                        static_cast<int64_t>(at + instruction.length);
+        if (!fits_rel32(moved)) {
+          return false;
+        }
+
+        put_rel32(&code.at(code.size() - instruction.length +
+                           instruction.displacement),
+                  moved);
+      }
+    }
+
+    covered += instruction.length;
+
+    // the function ends before there is room for the jump
+    if (instruction.ends && covered < minimum) {
+      return false;
+    }
+  }
+
+  // a branch back into the copied bytes would land in the middle of the jump
+  for (uintptr_t to : branches) {
+    if (to > target && to < target + covered) {
+      return false;
+    }
+  }
+
+  append_absolute_jump(code, target + covered);
+  return true;
+}
+
+std::mutex hook_mutex;
+
+// an attached hook, by the address of its trampoline. guarded by
+// hook_mutex
+struct inline_hook {
+  uintptr_t target;
+  void* to;
+  uintptr_t trampoline;
+  std::vector<uint8_t> original;
+  std::vector<uint8_t> patch;
+};
+
+std::unordered_map<uintptr_t, inline_hook> inline_hooks;
+
+// the hook being written. read by the signal handlers, so plain arrays
+struct patch_state {
+  std::atomic<uintptr_t> target;
+  uintptr_t trampoline;
+  size_t covered;
+  size_t boundary_count;
+  uint8_t from[32];
+  uint8_t to[32];
+  std::atomic<size_t> acknowledged;
+};
+
+patch_state patching;
+struct sigaction previous_move_action;
+
+bool on_patch_trap(siginfo_t* info, void* context) {
+  const uintptr_t instruction = instruction_pointer(context) - 1;
+  uintptr_t target = patching.target.load();
+
+  if (info->si_code != SI_KERNEL) {
+    return false;
+  }
+
+  // the int3 at target has run, so the thread was about to enter it
+  if (target && instruction == target) {
+    set_instruction_pointer(context, patching.trampoline);
+    return true;
+  }
+
+  // the write finished before the handler ran, the int3 is gone and the
+  // bytes now there run instead
+  if (*reinterpret_cast<const volatile uint8_t*>(instruction) != 0xcc) {
+    set_instruction_pointer(context, instruction);
+    return true;
+  }
+
+  return false;
+}
+
+// a thread stopped between the instructions of a prologue being replaced
+// continues at the same instruction of the trampoline
+void on_move(int32_t signal, siginfo_t* info, void* context) {
+  if (info->si_code != SI_QUEUE || info->si_value.sival_ptr != &patching) {
+    chain_signal(previous_move_action, signal, info, context);
+    return;
+  }
+
+  uintptr_t target = patching.target.load();
+  uintptr_t instruction = instruction_pointer(context);
+
+  if (target && instruction > target &&
+      instruction < target + patching.covered) {
+    for (size_t n = 0; n < patching.boundary_count; ++n) {
+      if (instruction == target + patching.from[n]) {
+        set_instruction_pointer(context,
+                                patching.trampoline + patching.to[n]);
+      }
+    }
+  }
+
+  ++patching.acknowledged;
+}
+
+// SIGURG is ignored by default, so a process not expecting it is unharmed
+// by a late delivery
+void install_move_handler() {
+  static std::once_flag installed;
+
+  std::call_once(installed, []() {
+    struct sigaction action = {};
+    action.sa_sigaction = on_move;
+    action.sa_flags = SA_SIGINFO | SA_RESTART | SA_ONSTACK;
+    sigemptyset(&action.sa_mask);
+
+    sigaction(SIGURG, &action, &previous_move_action);
+  });
+}
+
+// signals every other thread of the process to run on_move and waits for
+// the answers. a thread blocking the signal is given up on after a while
+void move_threads() {
+  const pid_t process = getpid();
+  const pid_t self = static_cast<pid_t>(syscall(SYS_gettid));
+
+  patching.acknowledged = 0;
+  size_t signaled = 0;
+
+  if (DIR* tasks = opendir("/proc/self/task")) {
+    while (dirent* task = readdir(tasks)) {
+      pid_t thread = static_cast<pid_t>(strtol(task->d_name, nullptr, 10));
+      if (thread <= 0 || thread == self) {
+        continue;
+      }
+
+      siginfo_t info = {};
+      info.si_signo = SIGURG;
+      info.si_code = SI_QUEUE;
+      info.si_pid = process;
+      info.si_uid = getuid();
+      info.si_value.sival_ptr = &patching;
+
+      if (syscall(SYS_rt_tgsigqueueinfo, process, thread, SIGURG, &info) ==
+          0) {
+        ++signaled;
+      }
+    }
+
+    closedir(tasks);
+  }
+
+  auto deadline = std::chrono::steady_clock::now() +
+                  std::chrono::milliseconds(100);
+  while (patching.acknowledged.load() < signaled &&
+         std::chrono::steady_clock::now() < deadline) {
+    std::this_thread::yield();
+  }
+}
+
+// serializes the instruction stream of every core running this process,
+// so none keeps executing bytes just replaced
+void synchronize_cores() {
+#ifdef SYS_membarrier
+  static const bool registered =
+      syscall(SYS_membarrier,
+              MEMBARRIER_CMD_REGISTER_PRIVATE_EXPEDITED_SYNC_CORE, 0) == 0;
+
+  if (registered) {
+    syscall(SYS_membarrier, MEMBARRIER_CMD_PRIVATE_EXPEDITED_SYNC_CORE, 0);
+  }
+#endif
+}
+
+// replaces the bytes at target while other threads may run them: an int3
+// goes in first, which sends a thread reaching target to the trampoline,
+// then the rest of the bytes, then the first byte
+bool write_code(uintptr_t target,
+                const std::vector<uint8_t>& bytes,
+                bool move) {
+  install_trap_handler();
+  patching.target = target;
+
+  bool result = mnemosyne::address(target).fill_memory(0xcc, 1);
+  synchronize_cores();
+
+  if (result && move) {
+    move_threads();
+  }
+
+  result = result &&
+           mnemosyne::address(target + 1)
+               .copy_memory(bytes.data() + 1, bytes.size() - 1);
+  synchronize_cores();
+
+  result = mnemosyne::address(target).copy_memory(bytes.data(), 1) && result;
+  synchronize_cores();
+
+  patching.target = 0;
+  return result;
+}
+
+bool attach_inline_hook(void** ptr, void* to) {
+  std::lock_guard<std::mutex> lock(hook_mutex);
+  const auto target = reinterpret_cast<uintptr_t>(*ptr);
+  constexpr size_t jump_size = 5;
+
+  if (!target) {
+    return false;
+  }
+
+  // the relay jumps to the detour from within reach of a rel32, followed
+  // by the trampoline running the original prologue. branches are always
+  // rel32 once relocated, so a first pass near target gives the size
+  constexpr size_t relay_size = 16;
+  std::vector<uint8_t> code;
+  std::vector<uint8_t> trampoline;
+  size_t covered = 0;
+  std::vector<std::pair<uint8_t, uint8_t>> boundaries;
+
+  if (!relocate_prologue(target, jump_size, target, trampoline, covered,
+                         boundaries) ||
+      boundaries.size() > sizeof(patching.from)) {
+    return false;
+  }
+
+  mnemosyne::code_arena& arena = mnemosyne::code_arena::shared();
+  uintptr_t slot = arena.allocate(target, relay_size + trampoline.size());
+
+  trampoline.clear();
+  boundaries.clear();
+  if (!slot || !relocate_prologue(target, jump_size, slot + relay_size,
+                                  trampoline, covered, boundaries)) {
+    arena.release(slot);
+    return false;
+  }
+
+  append_absolute_jump(code, reinterpret_cast<uintptr_t>(to));
+  code.resize(relay_size, 0xcc);
+  code.insert(code.end(), trampoline.begin(), trampoline.end());
+
+  if (!arena.write(slot, code.data(), code.size())) {
+    arena.release(slot);
+    return false;
+  }
+
+  inline_hook hook;
+  hook.target = target;
+  hook.to = to;
+  hook.trampoline = slot + relay_size;
+  hook.original.resize(covered);
+  memcpy(hook.original.data(), reinterpret_cast<const void*>(target),
+         covered);
+
+  // what is left of the prologue after the jump is never run
+  hook.patch.assign(covered, 0xcc);
+  hook.patch.at(0) = 0xe9;
+  put_rel32(&hook.patch.at(1),
+            static_cast<int64_t>(slot - (target + jump_size)));
+
+  patching.trampoline = hook.trampoline;
+  patching.covered = covered;
+  patching.boundary_count = boundaries.size();
+  for (size_t n = 0; n < boundaries.size(); ++n) {
+    patching.from[n] = boundaries.at(n).first;
+    patching.to[n] = boundaries.at(n).second;
+  }
+
+  install_move_handler();
+  if (!write_code(target, hook.patch, true)) {
+    write_code(target, hook.original, false);
+    return false;
+  }
+
+  *ptr = reinterpret_cast<void*>(hook.trampoline);
+  inline_hooks[hook.trampoline] = std::move(hook);
+
+  return true;
+}
+
+// trampolines stay mapped, a thread may still be running one
+bool detach_inline_hook(void** ptr, void* to) {
+  std::lock_guard<std::mutex> lock(hook_mutex);
+
+  auto it = inline_hooks.find(reinterpret_cast<uintptr_t>(*ptr));
+  if (it == inline_hooks.end() || it->second.to != to) {
+    return false;
+  }
+
+  // hooks on the same function come off in the reverse order
+  const inline_hook& hook = it->second;
+  if (memcmp(reinterpret_cast<const void*>(hook.target), hook.patch.data(),
+             hook.patch.size())) {
+    return false;
+  }
+
+  patching.trampoline = hook.trampoline;
+  patching.covered = 0;
+  if (!write_code(hook.target, hook.original, false)) {
+    return false;
+  }
+
+  *ptr = reinterpret_cast<void*>(hook.target);
+  inline_hooks.erase(it);
+
+  return true;
+}
+}  // namespace
+#endif
+
+mnemosyne::memory_redirect::memory_redirect(void** ptr, void* to)
+    : ptr(ptr), to(to) {
+  this->detours = [](void** ptr, void* to, bool enable) -> bool {
+#ifdef _WIN32
+    if (DetourTransactionBegin() != NO_ERROR) {
+      return false;
+    }
+
+    if (DetourUpdateThread(GetCurrentThread()) != NO_ERROR) {
+      DetourTransactionAbort();
+      return false;
+    }
+
+    if ((enable ? DetourAttach : DetourDetach)(ptr, to) != NO_ERROR) {
+      DetourTransactionAbort();
+      return false;
+    }
+
+    return DetourTransactionCommit() == NO_ERROR;
+#elif defined(MNEMOSYNE_INLINE_HOOK)
+    return enable ? attach_inline_hook(ptr, to) : detach_inline_hook(ptr, to);
+#else
+    // detours is windows only
+    return false;
+#endif
+  };
+}
+
+bool mnemosyne::memory_redirect::edit() {
+  return this->detours(this->ptr, this->to, true);
+}
+
+bool mnemosyne::memory_redirect::revert() {
+  return this->detours(this->ptr, this->to, false);
+}
+
+mnemosyne::memory_redirect::memory_redirect() {}
+
+mnemosyne::redirect_batch::redirect_batch() {}
+
+size_t mnemosyne::redirect_batch::add(const memory_redirect& redirect) {
+  this->entries.push_back({redirect.ptr, redirect.to});
+  return this->entries.size() - 1;
+}
+
+bool mnemosyne::redirect_batch::attach() {
+  return this->commit(true);
+}
+
+bool mnemosyne::redirect_batch::detach() {
+  return this->commit(false);
+}
+
+void mnemosyne::redirect_batch::clear() {
+  this->entries.clear();
+}
+
+size_t mnemosyne::redirect_batch::size() const {
+  return this->entries.size();
+}
+
+bool mnemosyne::redirect_batch::commit(bool enable) {
+#ifdef _WIN32
+  if (this->entries.empty()) {
+    return true;
+  }
+
+  if (DetourTransactionBegin() != NO_ERROR) {
+    return false;
+  }
+
+  // every other thread is suspended until the commit, and moved off any
+  // instruction the transaction rewrites
+  std::vector<HANDLE> threads;
+  HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+  if (snapshot != INVALID_HANDLE_VALUE) {
+    THREADENTRY32 thread = {};
+    thread.dwSize = sizeof(thread);
+
+    for (BOOL more = Thread32First(snapshot, &thread); more;
+         more = Thread32Next(snapshot, &thread)) {
+      if (thread.th32OwnerProcessID != GetCurrentProcessId() ||
+          thread.th32ThreadID == GetCurrentThreadId()) {
+        continue;
+      }
+
+      HANDLE handle = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT |
+                                     THREAD_SET_CONTEXT,
+                                 FALSE, thread.th32ThreadID);
+
+      // a thread that exited since the snapshot is skipped
+      if (handle && DetourUpdateThread(handle) == NO_ERROR) {
+        threads.push_back(handle);
+      } else if (handle) {
+        CloseHandle(handle);
+      }
+    }
+
+    CloseHandle(snapshot);
+  }
+
+  bool result = true;
+  for (const auto& e : this->entries) {
+    if ((enable ? DetourAttach : DetourDetach)(e.ptr, e.to) != NO_ERROR) {
+      result = false;
+      break;
+    }
+  }
+
+  if (result) {
+    result = DetourTransactionCommit() == NO_ERROR;
+  } else {
+    DetourTransactionAbort();
+  }
+
+  for (HANDLE handle : threads) {
+    CloseHandle(handle);
+  }
+
+  return result;
+#elif defined(MNEMOSYNE_INLINE_HOOK)
+  // one hook at a time, undoing the ones done if a later one fails.
+  // detached in the reverse order, for hooks on the same function
+  const size_t count = this->entries.size();
+  auto at = [&](size_t n) -> entry& {
+    return this->entries.at(enable ? n : count - 1 - n);
+  };
+
+  for (size_t n = 0; n < count; ++n) {
+    if (!(enable ? attach_inline_hook : detach_inline_hook)(at(n).ptr,
+                                                            at(n).to)) {
+      while (n--) {
+        (enable ? detach_inline_hook : attach_inline_hook)(at(n).ptr,
+                                                           at(n).to);
+      }
+
+      return false;
+    }
+  }
+
+  return true;
+#else
+  // detours is windows only
+  static_cast<void>(enable);
+  return false;
+#endif
+}
+
+namespace {
+// got or import address table entries of a loaded module, by symbol, and on
+// windows by "library!symbol" with the library in lower case
+struct import_table {
+  bool parsed;
+  std::string name;
+  std::unordered_map<std::string, std::vector<uintptr_t>> slots;
+};
+
+// parsed once per module, by base address. a module loaded at the base of
+// an unloaded one with another name is parsed again
+std::mutex import_mutex;
+std::unordered_map<uintptr_t, import_table> import_tables;
+
+#ifdef _WIN32
+std::string lowercase(std::string text) {
+  for (char& c : text) {
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  }
+
+  return text;
+}
+
+std::string import_key(const std::string& library, const std::string& symbol) {
+  return lowercase(library) + "!" + symbol;
+}
+
+// imports by ordinal, and bound ones without names, are left out
+void read_imports(uintptr_t base, import_table& table) {
+  auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(base);
+  if (dos->e_magic != IMAGE_DOS_SIGNATURE) {
+    return;
+  }
+
+  auto nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(base + dos->e_lfanew);
+  const IMAGE_DATA_DIRECTORY& directory =
+      nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+  if (!directory.VirtualAddress) {
+    return;
+  }
+
+  for (auto descriptor = reinterpret_cast<const IMAGE_IMPORT_DESCRIPTOR*>(
+           base + directory.VirtualAddress);
+       descriptor->Name; ++descriptor) {
+    if (!descriptor->OriginalFirstThunk) {
+      continue;
+    }
+
+    auto library = reinterpret_cast<const char*>(base + descriptor->Name);
+    auto names = reinterpret_cast<const IMAGE_THUNK_DATA*>(
+        base + descriptor->OriginalFirstThunk);
+    auto functions =
+        reinterpret_cast<IMAGE_THUNK_DATA*>(base + descriptor->FirstThunk);
+
+    for (size_t n = 0; names[n].u1.AddressOfData; ++n) {
+      if (IMAGE_SNAP_BY_ORDINAL(names[n].u1.Ordinal)) {
+        continue;
+      }
+
+      auto by_name = reinterpret_cast<const IMAGE_IMPORT_BY_NAME*>(
+          base + names[n].u1.AddressOfData);
+      table.slots[import_key(library, by_name->Name)].push_back(
+          reinterpret_cast<uintptr_t>(&functions[n].u1.Function));
+    }
+  }
+}
+
+std::vector<uintptr_t> import_slots(const std::string& key) {
+  std::vector<uintptr_t> slots;
+  std::lock_guard<std::mutex> lock(import_mutex);
+
+  for (const auto& module : mnemosyne::regions::modules()) {
+    import_table& table = import_tables[module.range.start];
+
+    if (!table.parsed || table.name != module.name) {
+      table = {true, module.name, {}};
+      read_imports(module.range.start, table);
+    }
+
+    auto it = table.slots.find(key);
+    if (it != table.slots.end()) {
+      slots.insert(slots.end(), it->second.begin(), it->second.end());
+    }
+  }
+
+  return slots;
+}
+#else
+#if defined(__x86_64__)
+const uint32_t jump_slot = R_X86_64_JUMP_SLOT;
+const uint32_t global_data = R_X86_64_GLOB_DAT;
+#elif defined(__i386__)
+const uint32_t jump_slot = R_386_JMP_SLOT;
+const uint32_t global_data = R_386_GLOB_DAT;
+#elif defined(__aarch64__)
+const uint32_t jump_slot = R_AARCH64_JUMP_SLOT;
+const uint32_t global_data = R_AARCH64_GLOB_DAT;
+#elif defined(__arm__)
+const uint32_t jump_slot = R_ARM_JUMP_SLOT;
+const uint32_t global_data = R_ARM_GLOB_DAT;
+#else
+// relocation types of other architectures are not known, nothing matches
+const uint32_t jump_slot = UINT32_MAX;
+const uint32_t global_data = UINT32_MAX;
+#endif
+
+// got entries of the plt and of -fno-plt calls and function pointers
+template <typename relocation>
+void read_relocations(uintptr_t base,
+                      uintptr_t table,
+                      size_t size,
+                      const ElfW(Sym)* symbols,
+                      const char* strings,
+                      import_table& imports) {
+  auto relocations = reinterpret_cast<const relocation*>(table);
+
+  for (size_t n = 0; n < size / sizeof(relocation); ++n) {
+#if UINTPTR_MAX == UINT64_MAX
+    const uint32_t type = ELF64_R_TYPE(relocations[n].r_info);
+    const size_t symbol = ELF64_R_SYM(relocations[n].r_info);
+#else
+    const uint32_t type = ELF32_R_TYPE(relocations[n].r_info);
+    const size_t symbol = ELF32_R_SYM(relocations[n].r_info);
+#endif
+
+    if ((type != jump_slot && type != global_data) || !symbol ||
+        !symbols[symbol].st_name) {
+      continue;
+    }
+
+    imports.slots[strings + symbols[symbol].st_name].push_back(
+        base + relocations[n].r_offset);
+  }
+}
+
+void read_imports(const dl_phdr_info* info, import_table& table) {
+  const uintptr_t base = info->dlpi_addr;
+  const ElfW(Dyn)* dynamic = nullptr;
+
+  for (size_t n = 0; n < info->dlpi_phnum; ++n) {
+    if (info->dlpi_phdr[n].p_type == PT_DYNAMIC) {
+      dynamic =
+          reinterpret_cast<const ElfW(Dyn)*>(base + info->dlpi_phdr[n].p_vaddr);
+    }
+  }
+
+  if (!dynamic) {
+    return;
+  }
+
+  // the loader relocates these in place, except for the vdso and on a few
+  // architectures
+  auto pointer = [base](uintptr_t value) {
+    return value < base ? base + value : value;
+  };
+
+  uintptr_t symbols = 0, strings = 0, plt = 0, rela = 0, rel = 0;
+  size_t plt_size = 0, rela_size = 0, rel_size = 0;
+  bool plt_rela = false;
+
+  for (const ElfW(Dyn)* d = dynamic; d->d_tag != DT_NULL; ++d) {
+    switch (d->d_tag) {
+      case DT_SYMTAB:
+        symbols = pointer(d->d_un.d_ptr);
+        break;
+      case DT_STRTAB:
+        strings = pointer(d->d_un.d_ptr);
+        break;
+      case DT_JMPREL:
+        plt = pointer(d->d_un.d_ptr);
+        break;
+      case DT_PLTRELSZ:
+        plt_size = d->d_un.d_val;
+        break;
+      case DT_PLTREL:
+        plt_rela = d->d_un.d_val == DT_RELA;
+        break;
+      case DT_RELA:
+        rela = pointer(d->d_un.d_ptr);
+        break;
+      case DT_RELASZ:
+        rela_size = d->d_un.d_val;
+        break;
+      case DT_REL:
+        rel = pointer(d->d_un.d_ptr);
+        break;
+      case DT_RELSZ:
+        rel_size = d->d_un.d_val;
+        break;
+    }
+  }
+
+  if (!symbols || !strings) {
+    return;
+  }
+
+  auto symbol_table = reinterpret_cast<const ElfW(Sym)*>(symbols);
+  auto string_table = reinterpret_cast<const char*>(strings);
+
+  if (plt && plt_rela) {
+    read_relocations<ElfW(Rela)>(base, plt, plt_size, symbol_table,
+                                 string_table, table);
+  } else if (plt) {
+    read_relocations<ElfW(Rel)>(base, plt, plt_size, symbol_table,
+                                string_table, table);
+  }
+
+  if (rela) {
+    read_relocations<ElfW(Rela)>(base, rela, rela_size, symbol_table,
+                                 string_table, table);
+  }
+
+  if (rel) {
+    read_relocations<ElfW(Rel)>(base, rel, rel_size, symbol_table,
+                                string_table, table);
+  }
+}
+
+std::vector<uintptr_t> import_slots(const std::string& key) {
+  struct search {
+    const std::string& key;
+    std::vector<uintptr_t> slots;
+  } context = {key, {}};
+
+  std::lock_guard<std::mutex> lock(import_mutex);
+
+  // modules can not be unloaded while they are iterated
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) -> int {
+        auto context = static_cast<search*>(data);
+        const std::string name = info->dlpi_name ? info->dlpi_name : "";
+        import_table& table = import_tables[info->dlpi_addr];
+
+        if (!table.parsed || table.name != name) {
+          table = {true, name, {}};
+          read_imports(info, table);
+        }
+
+        auto it = table.slots.find(context->key);
+        if (it != table.slots.end()) {
+          context->slots.insert(context->slots.end(), it->second.begin(),
+                                it->second.end());
+        }
+
+        return 0;
+      },
+      &context);
+
+  return context.slots;
+}
+#endif
+
+void* resolve_export(const std::string& library, const std::string& symbol) {
+#ifdef _WIN32
+  HMODULE module = GetModuleHandleA(library.c_str());
+  if (!module) {
+    return nullptr;
+  }
+
+  return reinterpret_cast<void*>(GetProcAddress(module, symbol.c_str()));
+#else
+  if (library.empty()) {
+    return dlsym(RTLD_DEFAULT, symbol.c_str());
+  }
+
+  void* module = dlopen(library.c_str(), RTLD_LAZY | RTLD_NOLOAD);
+  if (!module) {
+    return nullptr;
+  }
+
+  void* function = dlsym(module, symbol.c_str());
+  dlclose(module);
+
+  return function;
+#endif
+}
+
+// one aligned store, other threads call through either pointer
+bool write_slot(void** slot, void* value) {
+  mnemosyne::platform::protection_change change;
+  if (!mnemosyne::platform::make_writable(slot, sizeof(value), change)) {
+    return false;
+  }
+
+  *reinterpret_cast<void* volatile*>(slot) = value;
+  mnemosyne::platform::restore(change);
+
+  return true;
+}
+}  // namespace
+
+mnemosyne::table_redirect::table_redirect(const std::string& library,
+                                          const std::string& symbol,
+                                          void* to)
+    : library(library), symbol(symbol), to(to), resolved(nullptr) {}
+
+bool mnemosyne::table_redirect::edit() {
+  // already edited, revert() first to take in modules loaded since
+  if (!this->rewritten.empty()) {
+    return false;
+  }
+
+  this->resolved = resolve_export(this->library, this->symbol);
+
+#ifdef _WIN32
+  const std::string key = import_key(this->library, this->symbol);
+#else
+  const std::string& key = this->symbol;
+#endif
+
+  for (uintptr_t slot : import_slots(key)) {
+    void** at = reinterpret_cast<void**>(slot);
+    void* previous = nullptr;
+
+    if (!platform::read(&previous, at, sizeof(previous)) ||
+        previous == this->to) {
+      continue;
+    }
+
+    if (write_slot(at, this->to)) {
+      this->rewritten.push_back({at, previous});
+    }
+  }
+
+  return !this->rewritten.empty();
+}
+
+bool mnemosyne::table_redirect::revert() {
+  if (this->rewritten.empty()) {
+    return false;
+  }
+
+  // entries of unloaded modules, or rewritten by someone else since, are
+  // left alone
+  for (const auto& e : this->rewritten) {
+    void* current = nullptr;
+
+    if (platform::read(&current, e.slot, sizeof(current)) &&
+        current == this->to) {
+      write_slot(e.slot, e.previous);
+    }
+  }
+
+  this->rewritten.clear();
+  return true;
+}
+
+void* mnemosyne::table_redirect::original() const {
+  return this->resolved;
+}
+
+size_t mnemosyne::table_redirect::entries() const {
+  return this->rewritten.size();
+}
+
+#if (defined(_WIN64) && defined(_M_X64)) || defined(MNEMOSYNE_INLINE_HOOK)
+#define MNEMOSYNE_PROBE
+#endif
+
+namespace mnemosyne {
+struct probe::state {
+  // written by a single thread, read by collect() at any time
+  struct counters {
+    std::atomic<uint64_t> calls;
+    std::atomic<uint64_t> timed;
+    std::atomic<uint64_t> ticks;
+    std::atomic<uint64_t> histogram[bucket_count];
+  };
+
+  // the function, then its trampoline while attached
+  void* original;
+  memory_redirect redirect;
+  // thunks in the shared code arena, 0 if they could not be made
+  uintptr_t entry;
+  uintptr_t exit;
+  // index of the counters in those of every thread
+  size_t id;
+  bool attached;
+
+  std::mutex mutex;
+  std::vector<std::unique_ptr<counters>> threads;
+
+  state(void* function, size_t id)
+      : original(function),
+        redirect(&this->original, nullptr),
+        entry(0),
+        exit(0),
+        id(id),
+        attached(false) {}
+};
+
+#ifdef MNEMOSYNE_PROBE
+// called by the thunks. every thread keeps its own stack of the calls
+// being timed, with the return addresses they replaced
+class probe_runtime {
+ public:
+  // slot holds the return address of the call
+  static void enter(probe::state* state, uintptr_t* slot);
+  // stack is the stack pointer after the return, returns where to go on
+  static uintptr_t leave(uintptr_t stack);
+
+ private:
+  static constexpr size_t depth_limit = 64;
+
+  struct frame {
+    probe::state::counters* counters;
+    uintptr_t return_address;
+    uintptr_t* slot;
+    // exit thunk written to the slot
+    uintptr_t exit;
+    uint64_t start;
+  };
+
+  struct frame_stack {
+    frame frames[depth_limit];
+    size_t depth;
+  };
+
+  static thread_local frame_stack stack;
+  // by probe id
+  static thread_local std::vector<probe::state::counters*> counters;
+
+  static probe::state::counters* counters_of(probe::state* state);
+};
+
+thread_local probe_runtime::frame_stack probe_runtime::stack;
+thread_local std::vector<probe::state::counters*> probe_runtime::counters;
+#endif
+}  // namespace mnemosyne
+
+namespace {
+std::atomic<size_t> probe_ids(0);
+
+#ifdef MNEMOSYNE_PROBE
+// only this thread writes the counter, so no locked add is needed
+inline void add_relaxed(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value,
+                std::memory_order_relaxed);
+}
+
+void append_imm64(std::vector<uint8_t>& code, uint64_t value) {
+  for (size_t n = 0; n < sizeof(value); ++n) {
+    code.push_back(static_cast<uint8_t>(value >> (n * 8)));
+  }
+}
+
+// movdqu of xmm0 to xmm<count - 1> at [rsp + offset], 0x7f stores and 0x6f
+// loads
+void append_xmm_moves(std::vector<uint8_t>& code,
+                      uint8_t op,
+                      size_t count,
+                      uint32_t offset) {
+  for (size_t n = 0; n < count; ++n) {
+    const uint32_t at = offset + static_cast<uint32_t>(n * 16);
+    code.insert(code.end(), {0xf3, 0x0f, op,
+                             static_cast<uint8_t>(0x84 | (n << 3)), 0x24,
+                             static_cast<uint8_t>(at),
+                             static_cast<uint8_t>(at >> 8), 0x00, 0x00});
+  }
+}
+
+// saves the argument registers around enter(state, &return address) and
+// jumps on to the original function
+std::vector<uint8_t> entry_thunk(uintptr_t state,
+                                 uintptr_t enter,
+                                 uintptr_t original) {
+  // push rdi, rsi, rdx, rcx, r8, r9, rax, r10; sub rsp, 168
+  std::vector<uint8_t> code = {0x57, 0x56, 0x52, 0x51, 0x41, 0x50,
+                               0x41, 0x51, 0x50, 0x41, 0x52, 0x48,
+                               0x81, 0xec, 0xa8, 0x00, 0x00, 0x00};
+  append_xmm_moves(code, 0x7f, 8, 32);
+
+  // the return address is above the 168 bytes and the 8 pushes
+#ifdef _WIN32
+  code.insert(code.end(), {0x48, 0xb9});
+  append_imm64(code, state);
+  code.insert(code.end(), {0x48, 0x8d, 0x94, 0x24, 0xe8, 0x00, 0x00, 0x00});
+#else
+  code.insert(code.end(), {0x48, 0xbf});
+  append_imm64(code, state);
+  code.insert(code.end(), {0x48, 0x8d, 0xb4, 0x24, 0xe8, 0x00, 0x00, 0x00});
+#endif
+
+  // mov rax, enter; call rax
+  code.insert(code.end(), {0x48, 0xb8});
+  append_imm64(code, enter);
+  code.insert(code.end(), {0xff, 0xd0});
+
+  append_xmm_moves(code, 0x6f, 8, 32);
+  // add rsp, 168; pop r10, rax, r9, r8, rcx, rdx, rsi, rdi
+  code.insert(code.end(), {0x48, 0x81, 0xc4, 0xa8, 0x00, 0x00, 0x00, 0x41,
+                           0x5a, 0x58, 0x41, 0x59, 0x41, 0x58, 0x59, 0x5a,
+                           0x5e, 0x5f});
+
+  // mov r11, original; jmp [r11]
+  code.insert(code.end(), {0x49, 0xbb});
+  append_imm64(code, original);
+  code.insert(code.end(), {0x41, 0xff, 0x23});
+
+  return code;
+}
+
+// saves the return registers around leave(stack pointer) and jumps to the
+// return address it gives back
+std::vector<uint8_t> exit_thunk(uintptr_t leave) {
+  // push rax, rdx; sub rsp, 64
+  std::vector<uint8_t> code = {0x50, 0x52, 0x48, 0x83, 0xec, 0x40};
+  append_xmm_moves(code, 0x7f, 2, 32);
+
+#ifdef _WIN32
+  code.insert(code.end(), {0x48, 0x8d, 0x4c, 0x24, 0x50});
+#else
+  code.insert(code.end(), {0x48, 0x8d, 0x7c, 0x24, 0x50});
+#endif
+
+  // mov rax, leave; call rax; mov r11, rax
+  code.insert(code.end(), {0x48, 0xb8});
+  append_imm64(code, leave);
+  code.insert(code.end(), {0xff, 0xd0, 0x49, 0x89, 0xc3});
+
+  append_xmm_moves(code, 0x6f, 2, 32);
+  // add rsp, 64; pop rdx, rax; jmp r11
+  code.insert(code.end(),
+              {0x48, 0x83, 0xc4, 0x40, 0x5a, 0x58, 0x41, 0xff, 0xe3});
+
+  return code;
+}
+#endif
+}  // namespace
+
+#ifdef MNEMOSYNE_PROBE
+void mnemosyne::probe_runtime::enter(probe::state* state, uintptr_t* slot) {
+  probe::state::counters* counters = counters_of(state);
+  add_relaxed(counters->calls, 1);
+
+  // frames below this one were left by longjmp
+  frame_stack& s = stack;
+  while (s.depth && s.frames[s.depth - 1].slot < slot) {
+    --s.depth;
+  }
+
+  if (s.depth && s.frames[s.depth - 1].slot == slot) {
+    // a tail call returns through the exit thunk of its caller, the
+    // caller stays timed and this call is only counted
+    if (*slot == s.frames[s.depth - 1].exit) {
+      return;
+    }
+
+    --s.depth;
+  }
+
+  // counted but not timed
+  if (s.depth == depth_limit) {
+    return;
+  }
+
+  s.frames[s.depth++] = {counters, *slot, slot, state->exit, __rdtsc()};
+  *slot = state->exit;
+}
+
+uintptr_t mnemosyne::probe_runtime::leave(uintptr_t stack) {
+  const uint64_t end = __rdtsc();
+
+  // the returning call is on top, unless calls above it were left by
+  // longjmp
+  frame_stack& s = probe_runtime::stack;
+  while (s.depth > 1 &&
+         reinterpret_cast<uintptr_t>(s.frames[s.depth - 1].slot + 1) <
+             stack) {
+    --s.depth;
+  }
+
+  // only a return through a slot whose frame was dropped gets here, it
+  // has nowhere to go
+  if (!s.depth) {
+    std::abort();
+  }
+
+  const frame& f = s.frames[--s.depth];
+  const uint64_t ticks = end - f.start;
+
+  add_relaxed(f.counters->timed, 1);
+  add_relaxed(f.counters->ticks, ticks);
+  add_relaxed(f.counters->histogram[probe::bucket_of(ticks)], 1);
+
+  return f.return_address;
+}
+
+mnemosyne::probe::state::counters* mnemosyne::probe_runtime::counters_of(
+    probe::state* state) {
+  std::vector<probe::state::counters*>& own = counters;
+  if (state->id < own.size() && own[state->id]) {
+    return own[state->id];
+  }
+
+  // first call of this probe on this thread. the counters outlive the
+  // thread, its calls stay in collect()
+  std::lock_guard<std::mutex> lock(state->mutex);
+  state->threads.push_back(std::make_unique<probe::state::counters>());
+
+  if (own.size() <= state->id) {
+    own.resize(state->id + 1);
+  }
+
+  own[state->id] = state->threads.back().get();
+  return own[state->id];
+}
+#endif
+
+uint64_t mnemosyne::probe::statistics::percentile(double q) const {
+  uint64_t total = 0;
+  for (uint64_t n : this->histogram) {
+    total += n;
+  }
+
+  if (!total) {
+    return 0;
+  }
+
+  // 1 based rank of the call
+  const uint64_t rank = std::min(
+      total,
+      std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * total))));
+
+  uint64_t seen = 0;
+  for (size_t bucket = 0; bucket < this->histogram.size(); ++bucket) {
+    seen += this->histogram[bucket];
+
+    if (seen >= rank) {
+      return bucket + 1 < bucket_count ? bucket_start(bucket + 1) - 1
+                                       : UINT64_MAX;
+    }
+  }
+
+  return UINT64_MAX;
+}
+
+mnemosyne::probe::probe(void* function)
+    : shared(new state(function, probe_ids++)) {
+#ifdef MNEMOSYNE_PROBE
+  code_arena& arena = code_arena::shared();
+  const uintptr_t target = reinterpret_cast<uintptr_t>(function);
+
+  const std::vector<uint8_t> entry =
+      entry_thunk(reinterpret_cast<uintptr_t>(this->shared),
+                  reinterpret_cast<uintptr_t>(&probe_runtime::enter),
+                  reinterpret_cast<uintptr_t>(&this->shared->original));
+  const std::vector<uint8_t> exit =
+      exit_thunk(reinterpret_cast<uintptr_t>(&probe_runtime::leave));
+
+  const uintptr_t entry_slot = arena.allocate(target, entry.size());
+  const uintptr_t exit_slot = arena.allocate(target, exit.size());
+
+  if (!entry_slot || !exit_slot ||
+      !arena.write(entry_slot, entry.data(), entry.size()) ||
+      !arena.write(exit_slot, exit.data(), exit.size())) {
+    arena.release(entry_slot);
+    arena.release(exit_slot);
+    return;
+  }
+
+  this->shared->entry = entry_slot;
+  this->shared->exit = exit_slot;
+  this->shared->redirect = memory_redirect(
+      &this->shared->original, reinterpret_cast<void*>(entry_slot));
+#endif
+}
+
+mnemosyne::probe::~probe() {
+  // the state is kept, a thread may still be on its way through the thunks
+  this->detach();
+}
+
+bool mnemosyne::probe::attach() {
+  if (this->shared->attached) {
+    return true;
+  }
+
+  if (!this->shared->entry) {
+    return false;
+  }
+
+  this->shared->attached = this->shared->redirect.edit();
+  return this->shared->attached;
+}
+
+bool mnemosyne::probe::detach() {
+  if (!this->shared->attached) {
+    return true;
+  }
+
+  this->shared->attached = !this->shared->redirect.revert();
+  return !this->shared->attached;
+}
+
+bool mnemosyne::probe::attached() const {
+  return this->shared->attached;
+}
+
+mnemosyne::probe::statistics mnemosyne::probe::collect() const {
+  statistics result = {0, 0, 0, std::vector<uint64_t>(bucket_count)};
+
+  std::lock_guard<std::mutex> lock(this->shared->mutex);
+  for (const auto& counters : this->shared->threads) {
+    result.calls += counters->calls.load(std::memory_order_relaxed);
+    result.timed += counters->timed.load(std::memory_order_relaxed);
+    result.total_ticks += counters->ticks.load(std::memory_order_relaxed);
+
+    for (size_t bucket = 0; bucket < bucket_count; ++bucket) {
+      result.histogram[bucket] +=
+          counters->histogram[bucket].load(std::memory_order_relaxed);
+    }
+  }
+
+  return result;
+}
+
+size_t mnemosyne::probe::bucket_of(uint64_t ticks) {
+  if (ticks < 16) {
+    return static_cast<size_t>(ticks);
+  }
+
+  // 8 buckets from 2^e up to 2^47, the last one takes everything above
+  const uint32_t e = highest_bit(ticks);
+  if (e > 47) {
+    return bucket_count - 1;
+  }
+
+  return 16 + (e - 4) * 8 + static_cast<size_t>((ticks >> (e - 3)) & 7);
+}
+
+uint64_t mnemosyne::probe::bucket_start(size_t bucket) {
+  if (bucket < 16) {
+    return bucket;
+  }
+
+  const size_t e = 4 + (bucket - 16) / 8;
+  return (8 + (bucket - 16) % 8) << (e - 3);
+}
+
+uint64_t mnemosyne::probe::ticks_per_second() {
+#ifdef MNEMOSYNE_X86
+  static const uint64_t rate = []() {
+    const auto begin = std::chrono::steady_clock::now();
+    const uint64_t start = __rdtsc();
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+
+    const uint64_t end = __rdtsc();
+    const auto elapsed = std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - begin);
+
+    return static_cast<uint64_t>(static_cast<double>(end - start) * 1e9 /
+                                 static_cast<double>(elapsed.count()));
+  }();
+
+  return rate;
+#else
+  return 0;
+#endif
+}
+
+const std::string mnemosyne::util::byte_to_string(
+    const std::vector<uint8_t>& bytes,
+    const std::string& separator) {
+  std::stringstream ss;
+
+  for (size_t n = 0; n < bytes.size(); ++n) {
+    if (!separator.compare("\\x")) {
+      ss << separator << std::uppercase << std::hex << std::setw(2)
+         << std::setfill('0') << static_cast<int32_t>(bytes.at(n));
+    } else {
+      ss << std::uppercase << std::hex << std::setw(2) << std::setfill('0')
+         << static_cast<int32_t>(bytes.at(n));
+
+      if (bytes.size() - 1 != n) {
+        ss << separator;
+      }
+    }
+  }
+
+  return ss.str();
+}
+
+const std::vector<uint8_t> mnemosyne::util::string_to_bytes(
+    std::string byte_string) {
+  std::vector<uint8_t> bytes;
+
+  byte_string.erase(std::remove(byte_string.begin(), byte_string.end(), ' '),
+                    byte_string.end());
+  if (byte_string.empty() || byte_string.size() % 2) {
+    return bytes;
+  }
+
+  bytes.reserve(byte_string.size() / 2);
+
+  std::mt19937 mt(static_cast<uint32_t>(
+      std::chrono::system_clock::now().time_since_epoch().count()));
+  std::uniform_int_distribution<int16_t> dist(0, 15);
+  std::stringstream ss;
+
+  for (auto it = byte_string.begin(); it != byte_string.end(); ++it) {
+    if (!isxdigit(*it)) {
+      ss << std::hex << std::setw(1) << dist(mt);
+    } else {
+      ss << std::hex << std::setw(1) << *it;
+    }
+
+    if (ss.str().size() == 2) {
+      bytes.push_back(std::stoi(ss.str(), nullptr, 16));
+      ss.str("");
+    }
+  }
+
+  return bytes;
+}
+
+std::vector<mnemosyne::memory_region> mnemosyne::regions::query(
+    uintptr_t start,
+    size_t size) {
+  std::vector<memory_region> regions;
+  uintptr_t end = size > UINTPTR_MAX - start ? UINTPTR_MAX : start + size;
+
+  auto add = [&](uintptr_t low, uintptr_t high, bool readable, bool writable,
+                 bool executable) {
+    low = std::max(low, start);
+    high = std::min(high, end);
+
+    if (low < high) {
+      regions.push_back({low, high - low, readable, writable, executable});
+    }
+  };
+
+#ifdef _WIN32
+  MEMORY_BASIC_INFORMATION mbi = {0};
+  for (uintptr_t address = start; address < end;) {
+    if (VirtualQuery(reinterpret_cast<void*>(address), &mbi,
+                     sizeof(MEMORY_BASIC_INFORMATION)) !=
+        sizeof(MEMORY_BASIC_INFORMATION)) {
+      break;
+    }
+
+    memory_region region = region_from(mbi);
+    uintptr_t high = region.start + region.size;
+
+    if (mbi.State == MEM_COMMIT) {
+      add(region.start, high, region.readable, region.writable,
+          region.executable);
+    }
+
+    if (high <= address) {
+      break;
+    }
+
+    address = high;
+  }
+#else
+  for (const auto& region : parse_maps()) {
+    add(region.start, region.start + region.size, region.readable,
+        region.writable, region.executable);
+  }
+#endif
+
+  return regions;
+}
+
+std::vector<mnemosyne::memory_region> mnemosyne::regions::readable(
+    uintptr_t start,
+    size_t size) {
+  std::vector<memory_region> regions;
+
+  for (const auto& region : query(start, size)) {
+    if (!region.readable) {
+      continue;
+    }
+
+    if (!regions.empty() &&
+        regions.back().start + regions.back().size == region.start) {
+      regions.back().size += region.size;
+      regions.back().writable &= region.writable;
+      regions.back().executable &= region.executable;
+    } else {
+      regions.push_back(region);
+    }
+  }
+
+  return regions;
+}
+
+mnemosyne::memory_region mnemosyne::regions::module_range(
+    const std::string& name) {
+  memory_region range = {0, 0, true, false, false};
+
+#ifdef _WIN32
+  HMODULE module = GetModuleHandleA(name.empty() ? nullptr : name.c_str());
+  if (!module) {
+    return range;
+  }
+
+  auto dos = reinterpret_cast<IMAGE_DOS_HEADER*>(module);
+  auto nt = reinterpret_cast<IMAGE_NT_HEADERS*>(
+      reinterpret_cast<uintptr_t>(module) + dos->e_lfanew);
+
+  range.start = reinterpret_cast<uintptr_t>(module);
+  range.size = nt->OptionalHeader.SizeOfImage;
+#else
+  struct search {
+    const std::string& name;
+    memory_region& range;
+  } context = {name, range};
+
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) -> int {
+        auto context = static_cast<search*>(data);
+        std::string path = info->dlpi_name ? info->dlpi_name : "";
+        std::string file = path.substr(path.find_last_of('/') + 1);
+
+        // the main executable is reported first, with an empty name
+        if (context->name.empty() ? !path.empty()
+                                  : context->name != path &&
+                                        context->name != file) {
+          return 0;
+        }
+
+        uintptr_t low = UINTPTR_MAX, high = 0;
+        for (size_t n = 0; n < info->dlpi_phnum; ++n) {
+          const auto& header = info->dlpi_phdr[n];
+
+          if (header.p_type == PT_LOAD) {
+            low = std::min<uintptr_t>(low, info->dlpi_addr + header.p_vaddr);
+            high = std::max<uintptr_t>(
+                high, info->dlpi_addr + header.p_vaddr + header.p_memsz);
+          }
+        }
+
+        if (low < high) {
+          context->range.start = low;
+          context->range.size = high - low;
+        }
+
+        return 1;
+      },
+      &context);
+#endif
+
+  return range;
+}
+
+std::vector<mnemosyne::loaded_module> mnemosyne::regions::modules() {
+  std::vector<loaded_module> modules;
+
+#ifdef _WIN32
+  HANDLE process = GetCurrentProcess();
+  HMODULE main = GetModuleHandleA(nullptr);
+  std::vector<HMODULE> handles(1024);
+  DWORD needed = 0;
+
+  if (!EnumProcessModules(process, handles.data(),
+                          static_cast<DWORD>(handles.size() * sizeof(HMODULE)),
+                          &needed)) {
+    return modules;
+  }
+
+  handles.resize(std::min<size_t>(handles.size(), needed / sizeof(HMODULE)));
+  for (HMODULE handle : handles) {
+    MODULEINFO info = {0};
+    char name[MAX_PATH] = {0};
+
+    if (!GetModuleInformation(process, handle, &info, sizeof(MODULEINFO)) ||
+        (handle != main &&
+         !GetModuleBaseNameA(process, handle, name, MAX_PATH))) {
+      continue;
+    }
+
+    loaded_module module = {
+        name,
+        {reinterpret_cast<uintptr_t>(info.lpBaseOfDll), info.SizeOfImage,
+         true, false, false}};
+
+    // the main executable goes first, with an empty name
+    if (handle == main) {
+      modules.insert(modules.begin(), module);
+    } else {
+      modules.push_back(module);
+    }
+  }
+#else
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) -> int {
+        std::string path = info->dlpi_name ? info->dlpi_name : "";
+
+        uintptr_t low = UINTPTR_MAX, high = 0;
+        for (size_t n = 0; n < info->dlpi_phnum; ++n) {
+          const auto& header = info->dlpi_phdr[n];
+
+          if (header.p_type == PT_LOAD) {
+            low = std::min<uintptr_t>(low, info->dlpi_addr + header.p_vaddr);
+            high = std::max<uintptr_t>(
+                high, info->dlpi_addr + header.p_vaddr + header.p_memsz);
+          }
+        }
+
+        // the main executable is reported first, with an empty name
+        if (low < high) {
+          static_cast<std::vector<loaded_module>*>(data)->push_back(
+              {path.substr(path.find_last_of('/') + 1),
+               {low, high - low, true, false, false}});
+        }
+
+        return 0;
+      },
+      &modules);
+#endif
+
+  return modules;
+}
+
+mnemosyne::memory_region mnemosyne::regions::process_range() {
+  memory_region range = {0, 0, true, false, false};
+  auto mapped = query(0, UINTPTR_MAX);
+
+  if (!mapped.empty()) {
+    range.start = mapped.front().start;
+    range.size = mapped.back().start + mapped.back().size - range.start;
+  }
+
+  return range;
+}
+
+namespace {
+#ifdef _WIN32
+std::atomic<uint64_t> module_changes(0);
+
+void CALLBACK on_module_change(ULONG, const void*, void*) {
+  ++module_changes;
+}
+
+typedef LONG(NTAPI* register_dll_notification_t)(
+    ULONG flags,
+    void(CALLBACK* callback)(ULONG, const void*, void*),
+    void* context,
+    void** cookie);
+#endif
+
+// changes whenever a module is loaded or unloaded
+uint64_t module_generation() {
+#ifdef _WIN32
+  static std::once_flag registered;
+  static bool notified = false;
+
+  std::call_once(registered, []() {
+    HMODULE ntdll = GetModuleHandleA("ntdll.dll");
+    auto register_dll_notification =
+        reinterpret_cast<register_dll_notification_t>(
+            ntdll ? GetProcAddress(ntdll, "LdrRegisterDllNotification")
+                  : nullptr);
+    void* cookie = nullptr;
+
+    notified = register_dll_notification &&
+               register_dll_notification(0, &on_module_change, nullptr,
+                                         &cookie) >= 0;
+  });
+
+  // without notifications every lookup lists the modules again
+  return notified ? module_changes.load() : ++module_changes;
+#else
+  uint64_t generation = 0;
+
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t size, void* data) -> int {
+        // older loaders do not count loads and unloads
+        if (size >= offsetof(dl_phdr_info, dlpi_subs) +
+                        sizeof(info->dlpi_subs)) {
+          *static_cast<uint64_t*>(data) = info->dlpi_adds + info->dlpi_subs;
+        }
+
+        return 1;
+      },
+      &generation);
+
+  return generation;
+#endif
+}
+}  // namespace
+
+mnemosyne::module_map::module_map() : generation(0), listed(false) {}
+
+mnemosyne::module_map& mnemosyne::module_map::shared() {
+  static module_map* map = new module_map();
+  return *map;
+}
+
+std::vector<mnemosyne::loaded_module> mnemosyne::module_map::modules() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->find("");
+
+  std::vector<loaded_module> modules;
+  for (const auto& e : this->entries) {
+    modules.push_back(e.module);
+  }
+
+  return modules;
+}
+
+std::vector<mnemosyne::module_section> mnemosyne::module_map::sections(
+    const std::string& module) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  entry* e = this->find(module);
+  if (!e) {
+    return {};
+  }
+
+  this->parse(*e);
+  return e->sections;
+}
+
+mnemosyne::memory_region mnemosyne::module_map::section(
+    const std::string& module,
+    const std::string& name) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  entry* e = this->find(module);
+  if (e) {
+    this->parse(*e);
+
+    for (const auto& s : e->sections) {
+      if (s.name == name) {
+        return s.range;
+      }
+    }
+  }
+
+  return {0, 0, false, false, false};
+}
+
+uintptr_t mnemosyne::module_map::symbol(const std::string& module,
+                                        const std::string& name) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  entry* e = this->find(module);
+  if (!e) {
+    return 0;
+  }
+
+  this->index(*e);
+
+  auto it = e->symbols.find(name);
+  return it != e->symbols.end() ? it->second : 0;
+}
+
+void mnemosyne::module_map::invalidate() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->listed = false;
+}
+
+mnemosyne::module_map::entry* mnemosyne::module_map::find(
+    const std::string& module) {
+  const uint64_t current = module_generation();
+  if (!this->listed || current != this->generation) {
+    this->generation = current;
+    this->list();
+  }
+
+#ifdef _WIN32
+  std::string key = lowercase(module);
+  auto it = this->by_name.find(key);
+
+  // as GetModuleHandle, a name without an extension is a dll
+  if (it == this->by_name.end() && key.find('.') == std::string::npos) {
+    it = this->by_name.find(key + ".dll");
+  }
+#else
+  auto it = this->by_name.find(module);
+#endif
+
+  return it != this->by_name.end() ? &this->entries[it->second] : nullptr;
+}
+
+void mnemosyne::module_map::list() {
+  this->entries.clear();
+  this->by_name.clear();
+  this->listed = true;
+
+#ifdef _WIN32
+  for (const auto& module : regions::modules()) {
+    entry e = {};
+    e.module = module;
+    e.base = module.range.start;
+    e.path = module.name;
+
+    this->by_name.emplace(lowercase(module.name), this->entries.size());
+    this->entries.push_back(std::move(e));
+  }
+#else
+  dl_iterate_phdr(
+      [](dl_phdr_info* info, size_t, void* data) -> int {
+        auto map = static_cast<module_map*>(data);
+        const std::string path = info->dlpi_name ? info->dlpi_name : "";
+        entry e = {};
+        e.module = {path.substr(path.find_last_of('/') + 1),
+                    {0, 0, true, false, false}};
+        e.base = info->dlpi_addr;
+        e.path = path;
+
+        // segments stand in for the sections until they are read
+        uintptr_t low = UINTPTR_MAX, high = 0;
+        for (size_t n = 0; n < info->dlpi_phnum; ++n) {
+          const auto& header = info->dlpi_phdr[n];
+          if (header.p_type != PT_LOAD) {
+            continue;
+          }
+
+          const uintptr_t start = info->dlpi_addr + header.p_vaddr;
+          const bool writable = (header.p_flags & PF_W) != 0;
+          const bool executable = (header.p_flags & PF_X) != 0;
+
+          low = std::min(low, start);
+          high = std::max<uintptr_t>(high, start + header.p_memsz);
+          e.sections.push_back(
+              {executable ? ".text" : writable ? ".data" : ".rodata",
+               {start, header.p_memsz, true, writable, executable}});
+        }
+
+        if (low >= high) {
+          return 0;
+        }
+
+        e.module.range.start = low;
+        e.module.range.size = high - low;
+
+        // by path and by file name, the main executable first by ""
+        map->by_name.emplace(path, map->entries.size());
+        map->by_name.emplace(e.module.name, map->entries.size());
+        map->entries.push_back(std::move(e));
+
+        return 0;
+      },
+      this);
+#endif
+}
+
+void mnemosyne::module_map::parse(entry& e) {
+  if (e.parsed) {
+    return;
+  }
+
+  e.parsed = true;
+
+#ifdef _WIN32
+  auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(e.base);
+  auto nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(e.base + dos->e_lfanew);
+  const IMAGE_SECTION_HEADER* header = IMAGE_FIRST_SECTION(nt);
+
+  for (size_t n = 0; n < nt->FileHeader.NumberOfSections; ++n) {
+    const DWORD flags = header[n].Characteristics;
+    auto name = reinterpret_cast<const char*>(header[n].Name);
+
+    // names of all 8 characters are not terminated
+    e.sections.push_back(
+        {std::string(name, strnlen(name, IMAGE_SIZEOF_SHORT_NAME)),
+         {e.base + header[n].VirtualAddress, header[n].Misc.VirtualSize,
+          (flags & IMAGE_SCN_MEM_READ) != 0, (flags & IMAGE_SCN_MEM_WRITE) != 0,
+          (flags & IMAGE_SCN_MEM_EXECUTE) != 0}});
+  }
+#else
+  // section headers are not mapped, they are read from the file. the vdso
+  // has none, but is mapped whole, up to the end of its last page
+  std::ifstream file(e.path.empty() ? "/proc/self/exe" : e.path,
+                     std::ios::binary);
+  const bool from_file = file.is_open();
+  const size_t page_size = platform::page_size();
+  const size_t mapped =
+      (e.module.range.size + page_size - 1) & ~(page_size - 1);
+
+  auto read = [&](uint64_t offset, void* destination, size_t size) -> bool {
+    if (from_file) {
+      file.seekg(static_cast<std::streamoff>(offset));
+      return static_cast<bool>(
+          file.read(static_cast<char*>(destination), size));
+    }
+
+    return offset + size <= mapped &&
+           platform::read(destination,
+                          reinterpret_cast<const void*>(
+                              e.module.range.start + offset),
+                          size);
+  };
+
+  ElfW(Ehdr) header;
+  if (!read(0, &header, sizeof(header)) ||
+      memcmp(header.e_ident, ELFMAG, SELFMAG) ||
+      header.e_shentsize != sizeof(ElfW(Shdr)) || !header.e_shnum ||
+      header.e_shstrndx >= header.e_shnum) {
+    return;
+  }
+
+  std::vector<ElfW(Shdr)> headers(header.e_shnum);
+  if (!read(header.e_shoff, headers.data(),
+            headers.size() * sizeof(ElfW(Shdr)))) {
+    return;
+  }
+
+  const ElfW(Shdr)& names_header = headers[header.e_shstrndx];
+  std::vector<char> names(names_header.sh_size + 1, 0);
+  if (!read(names_header.sh_offset, names.data(), names_header.sh_size)) {
+    return;
+  }
+
+  std::vector<module_section> sections;
+  for (const auto& h : headers) {
+    // thread local sections are templates, not what threads see
+    if (!(h.sh_flags & SHF_ALLOC) || (h.sh_flags & SHF_TLS) || !h.sh_size ||
+        h.sh_name >= names_header.sh_size) {
+      continue;
+    }
+
+    sections.push_back({names.data() + h.sh_name,
+                        {e.base + h.sh_addr, h.sh_size, true,
+                         (h.sh_flags & SHF_WRITE) != 0,
+                         (h.sh_flags & SHF_EXECINSTR) != 0}});
+
+    if (h.sh_type == SHT_DYNSYM && h.sh_link < headers.size()) {
+      e.symbol_table = e.base + h.sh_addr;
+      e.symbol_count = h.sh_size / sizeof(ElfW(Sym));
+      e.string_table = e.base + headers[h.sh_link].sh_addr;
+    } else if (h.sh_type == SHT_GNU_versym) {
+      e.versions = e.base + h.sh_addr;
+    }
+  }
+
+  e.sections = std::move(sections);
+#endif
+}
+
+void mnemosyne::module_map::index(entry& e) {
+  if (e.indexed) {
+    return;
+  }
+
+  this->parse(e);
+  e.indexed = true;
+
+#ifdef _WIN32
+  auto dos = reinterpret_cast<const IMAGE_DOS_HEADER*>(e.base);
+  auto nt = reinterpret_cast<const IMAGE_NT_HEADERS*>(e.base + dos->e_lfanew);
+  const IMAGE_DATA_DIRECTORY& directory =
+      nt->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXPORT];
+  if (!directory.VirtualAddress) {
+    return;
+  }
+
+  auto exports = reinterpret_cast<const IMAGE_EXPORT_DIRECTORY*>(
+      e.base + directory.VirtualAddress);
+  auto names = reinterpret_cast<const DWORD*>(e.base + exports->AddressOfNames);
+  auto ordinals =
+      reinterpret_cast<const WORD*>(e.base + exports->AddressOfNameOrdinals);
+  auto functions =
+      reinterpret_cast<const DWORD*>(e.base + exports->AddressOfFunctions);
+
+  e.symbols.reserve(exports->NumberOfNames);
+  for (size_t n = 0; n < exports->NumberOfNames; ++n) {
+    auto name = reinterpret_cast<const char*>(e.base + names[n]);
+    const DWORD function = functions[ordinals[n]];
+
+    // forwarded exports name another module's function instead
+    if (function >= directory.VirtualAddress &&
+        function < directory.VirtualAddress + directory.Size) {
+      e.symbols.emplace(name,
+                        reinterpret_cast<uintptr_t>(GetProcAddress(
+                            reinterpret_cast<HMODULE>(e.base), name)));
+    } else {
+      e.symbols.emplace(name, e.base + function);
+    }
+  }
+#else
+  if (!e.symbol_table || !e.string_table) {
+    return;
+  }
+
+  auto symbols = reinterpret_cast<const ElfW(Sym)*>(e.symbol_table);
+  auto strings = reinterpret_cast<const char*>(e.string_table);
+  auto versions = reinterpret_cast<const ElfW(Versym)*>(e.versions);
+  void* handle = nullptr;
+
+  e.symbols.reserve(e.symbol_count);
+  for (size_t n = 1; n < e.symbol_count; ++n) {
+    const ElfW(Sym)& s = symbols[n];
+    const uint32_t type = ELF64_ST_TYPE(s.st_info);
+    const uint32_t binding = ELF64_ST_BIND(s.st_info);
+
+    // the high bit marks old versions kept for binaries built against them
+    if (s.st_shndx == SHN_UNDEF || s.st_shndx == SHN_ABS || !s.st_name ||
+        (binding != STB_GLOBAL && binding != STB_WEAK &&
+         binding != STB_GNU_UNIQUE) ||
+        (versions && (versions[n] & 0x8000))) {
+      continue;
+    }
+
+    const char* name = strings + s.st_name;
+    uintptr_t address = e.base + s.st_value;
+
+    if (type == STT_GNU_IFUNC) {
+      // the implementation the resolver picks, as the loader binds it
+      if (!handle) {
+        handle = dlopen(e.path.empty() ? nullptr : e.path.c_str(),
+                        RTLD_LAZY | RTLD_NOLOAD);
+      }
+
+      address = handle ? reinterpret_cast<uintptr_t>(dlsym(handle, name)) : 0;
+    } else if (type != STT_FUNC && type != STT_OBJECT) {
+      continue;
+    }
+
+    if (address) {
+      e.symbols.emplace(name, address);
+    }
+  }
+
+  if (handle) {
+    dlclose(handle);
+  }
+#endif
+}
+
+mnemosyne::pattern_match::pattern_match(const std::string& pattern,
+                                        void* memory_start,
+                                        size_t memory_size)
+    : pattern(pattern),
+      pattern_size(0),
+      memory_start(reinterpret_cast<uintptr_t>(memory_start)),
+      memory_size(memory_size),
+      current_address(reinterpret_cast<uintptr_t>(memory_start)),
+      source(nullptr),
+      generation(0),
+      borrowed({nullptr, nullptr, 0}),
+      anchor(0),
+      second_anchor(0),
+      engine(best_engine()) {
+  this->pattern_size =
+      parse_pattern(this->pattern, this->bytearray, this->mask);
+
+  select_anchors(this->bytearray.data(), this->mask.data(), this->pattern_size,
+                 this->anchor, this->second_anchor);
+}
+
+mnemosyne::pattern_match::pattern_match(const pattern_view& pattern,
+                                        void* memory_start,
+                                        size_t memory_size)
+    : pattern_size(pattern.size),
+      memory_start(reinterpret_cast<uintptr_t>(memory_start)),
+      memory_size(memory_size),
+      current_address(reinterpret_cast<uintptr_t>(memory_start)),
+      source(nullptr),
+      generation(0),
+      borrowed(pattern),
+      anchor(0),
+      second_anchor(0),
+      engine(best_engine()) {
+  if (!select_anchors(pattern.bytes, pattern.mask, pattern.size, this->anchor,
+                      this->second_anchor)) {
+    this->pattern_size = 0;
+  }
+}
+
+mnemosyne::pattern_match::pattern_match(const std::string& pattern,
+                                        memory_source& source,
+                                        uintptr_t memory_start,
+                                        size_t memory_size)
+    : pattern_match(pattern,
+                    reinterpret_cast<void*>(memory_start),
+                    memory_size) {
+  this->source = &source;
+}
+
+mnemosyne::pattern_match mnemosyne::pattern_match::in_module(
+    const std::string& pattern,
+    const std::string& module) {
+  memory_region range = regions::module_range(module);
+  return pattern_match(pattern, reinterpret_cast<void*>(range.start),
+                       range.size);
+}
+
+mnemosyne::pattern_match mnemosyne::pattern_match::in_process(
+    const std::string& pattern) {
+  memory_region range = regions::process_range();
+  return pattern_match(pattern, reinterpret_cast<void*>(range.start),
+                       range.size);
+}
+
+mnemosyne::pattern_match mnemosyne::pattern_match::in_section(
+    const std::string& pattern,
+    const std::string& module,
+    const std::string& section) {
+  memory_region range = module_map::shared().section(module, section);
+  return pattern_match(pattern, reinterpret_cast<void*>(range.start),
+                       range.size);
+}
+
+uintptr_t mnemosyne::pattern_match::find_address() {
+  this->refresh_regions();
+  return this->scan_from(this->memory_start);
+}
+
+uintptr_t mnemosyne::pattern_match::find_next_address() {
+  if (this->regions.empty()) {
+    this->refresh_regions();
+  }
+
+  return this->scan_from(this->current_address + 1);
+}
+
+uintptr_t mnemosyne::pattern_match::find_address_parallel(size_t threads) {
+  this->current_address = this->memory_start + this->memory_size;
+  this->refresh_regions();
+
+  auto chunks = split_into_chunks(this->regions, this->pattern_size);
+  std::vector<uintptr_t> found(chunks.size(), 0);
+  std::atomic<size_t> found_chunk(SIZE_MAX);
+
+  for_each_chunk(chunks.size(), threads, [&](size_t chunk) {
+    // a lower chunk already holds the result
+    if (chunk > found_chunk.load()) {
+      return;
+    }
+
+    bool faulted = false;
+    found.at(chunk) = this->scan_range(chunks.at(chunk).first,
+                                       chunks.at(chunk).second, faulted);
+
+    if (found.at(chunk)) {
+      store_min(found_chunk, chunk);
+    }
+  });
+
+  if (found_chunk == SIZE_MAX) {
+    return 0;
+  }
+
+  return this->current_address = found.at(found_chunk);
+}
+
+std::vector<uintptr_t> mnemosyne::pattern_match::find_all(size_t threads) {
+  this->refresh_regions();
+  return this->scan_all(this->regions, threads);
+}
+
+std::vector<uintptr_t> mnemosyne::pattern_match::rescan(
+    const std::vector<uintptr_t>& previous,
+    const std::vector<snapshot::range>& dirty,
+    size_t threads) {
+  this->refresh_regions();
+
+  auto starts =
+      overlapping_starts(dirty, this->pattern_size, this->memory_start,
+                         this->memory_start + this->memory_size);
+  std::vector<uintptr_t> found = this->scan_all(
+      regions_of_starts(this->regions, starts, this->pattern_size), threads);
+
+  // matches outside the dirty ranges still hold
+  std::vector<uintptr_t> kept;
+  kept.reserve(previous.size());
+  for (uintptr_t address : previous) {
+    if (!overlaps_ranges(starts, address, 1)) {
+      kept.push_back(address);
+    }
+  }
+
+  std::vector<uintptr_t> addresses(kept.size() + found.size());
+  std::merge(kept.begin(), kept.end(), found.begin(), found.end(),
+             addresses.begin());
+
+  return addresses;
+}
+
+std::vector<uintptr_t> mnemosyne::pattern_match::scan_all(
+    const std::vector<memory_region>& regions,
+    size_t threads) {
+  auto chunks = split_into_chunks(regions, this->pattern_size);
+  std::vector<std::vector<uintptr_t>> found(chunks.size());
+
+  for_each_chunk(chunks.size(), threads, [&](size_t chunk) {
+    uintptr_t last = chunks.at(chunk).second;
+    bool faulted = false;
+
+    for (uintptr_t address = chunks.at(chunk).first; address <= last;) {
+      address = this->scan_range(address, last, faulted);
+      if (!address) {
+        break;
+      }
+
+      found.at(chunk).push_back(address++);
+    }
+  });
+
+  std::vector<uintptr_t> addresses;
+  for (const auto& chunk : found) {
+    addresses.insert(addresses.end(), chunk.begin(), chunk.end());
+  }
+
+  return addresses;
+}
+
+mnemosyne::pattern_match::scan_engine
+mnemosyne::pattern_match::best_engine() {
+#ifdef MNEMOSYNE_X86
+  static const scan_engine best =
+      cpu_supports_avx2() ? scan_engine::avx2 : scan_engine::sse2;
+  return best;
+#else
+  return scan_engine::scalar;
+#endif
+}
+
+void mnemosyne::pattern_match::use_engine(scan_engine engine) {
+  this->engine = std::min(engine, best_engine());
+}
+
+mnemosyne::pattern_match::pattern_match() {}
+
+mnemosyne::pattern_view mnemosyne::pattern_match::view() const {
+  if (this->bytearray.empty()) {
+    return this->borrowed;
+  }
+
+  return {this->bytearray.data(), this->mask.data(), this->pattern_size};
+}
+
+void mnemosyne::pattern_match::refresh_regions() {
+  this->regions =
+      this->source
+          ? this->source->readable(this->memory_start, this->memory_size)
+          : regions::readable(this->memory_start, this->memory_size);
+  this->generation = ++scan_generation;
+}
+
+uintptr_t mnemosyne::pattern_match::scan_from(uintptr_t address) {
+  this->current_address = this->memory_start + this->memory_size;
+
+  if (!this->pattern_size) {
+    return 0;
+  }
+
+  for (const auto& region : this->regions) {
+    // a match must lie entirely inside the region
+    if (region.size < this->pattern_size) {
+      continue;
+    }
+
+    uintptr_t last = region.start + region.size - this->pattern_size;
+    if (address > last) {
+      continue;
+    }
+
+    // a page freed since the query only costs the rest of its region
+    bool faulted = false;
+    uintptr_t found =
+        this->scan_range(std::max(address, region.start), last, faulted);
+
+    if (found) {
+      this->current_address = found;
+      return found;
+    }
+  }
+
+  return 0;
+}
+
+uintptr_t mnemosyne::pattern_match::scan_range(uintptr_t first,
+                                               uintptr_t last,
+                                               bool& faulted) {
+  pattern_view view = this->view();
+  scan_pattern p = {view.bytes, view.mask, view.size, this->anchor,
+                    this->second_anchor};
+
+  auto scan = [&](uintptr_t low, uintptr_t high) {
+    switch (this->engine) {
+#ifdef MNEMOSYNE_X86
+      case scan_engine::avx2:
+        return scan_avx2(p, low, high);
+      case scan_engine::sse2:
+        return scan_sse2(p, low, high);
+#endif
+      default:
+        return scan_scalar(p, low, high);
+    }
+  };
+
+  if (!this->source || this->source->in_process()) {
+    uintptr_t found = 0;
+    faulted = !platform::guarded([&]() { found = scan(first, last); });
+    return faulted ? 0 : found;
+  }
+
+  // memory of another process is copied over a chunk at a time unless the
+  // source holds it in place. the copy is kept so find_all does not copy a
+  // chunk again for every match
+  faulted = false;
+  for (uintptr_t chunk = first;;) {
+    bool cached = copied.generation == this->generation &&
+                  chunk >= copied.start &&
+                  chunk - copied.start + view.size <= copied.bytes.size();
+
+    uintptr_t chunk_last =
+        cached ? copied.start + (copied.bytes.size() - view.size)
+               : chunk + std::min<uintptr_t>(last - chunk, scan_chunk_size - 1);
+    chunk_last = std::min(chunk_last, last);
+
+    const uint8_t* in_place =
+        cached ? nullptr
+               : this->source->in_place(chunk, chunk_last - chunk + view.size);
+
+    if (in_place) {
+      uintptr_t base = reinterpret_cast<uintptr_t>(in_place) - chunk;
+      uintptr_t found = 0;
+
+      if (!platform::guarded(
+              [&]() { found = scan(base + chunk, base + chunk_last); })) {
+        faulted = true;
+      } else if (found) {
+        return found - base;
+      }
+    } else {
+      if (!cached) {
+        copied.generation = 0;
+        copied.start = chunk;
+        copied.bytes.resize(chunk_last - chunk + view.size);
+
+        if (this->source->read(copied.bytes.data(), chunk,
+                               copied.bytes.size())) {
+          copied.generation = this->generation;
+        } else {
+          faulted = true;
+        }
+      }
+
+      if (copied.generation == this->generation) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(copied.bytes.data()) -
+                         copied.start;
+        uintptr_t found = scan(base + chunk, base + chunk_last);
+
+        if (found) {
+          return found - base;
+        }
+      }
+    }
+
+    if (chunk_last == last) {
+      return 0;
+    }
+
+    chunk = chunk_last + 1;
+  }
+}
+
+inline bool mnemosyne::pattern_match::try_match_at_current_address() {
+  pattern_view view = this->view();
+  scan_pattern p = {view.bytes, view.mask, view.size, this->anchor,
+                    this->second_anchor};
+
+  return verify_from(p, reinterpret_cast<const uint8_t*>(this->current_address),
+                     0);
+}
+
+mnemosyne::pattern_set::pattern_set(const std::vector<std::string>& patterns,
+                                    void* memory_start,
+                                    size_t memory_size)
+    : memory_start(reinterpret_cast<uintptr_t>(memory_start)),
+      memory_size(memory_size),
+      pair_index(0x10000 + 1, 0),
+      byte_index(0x100 + 1, 0) {
+  std::vector<uint32_t> pair_keys;
+  std::vector<uint32_t> byte_keys;
+
+  for (const auto& pattern : patterns) {
+    entry e = {this->bytearray.size(), 0, 0};
+    e.size = parse_pattern(pattern, this->bytearray, this->mask);
+
+    const uint8_t* bytes = this->bytearray.data() + e.offset;
+    const uint8_t* mask = this->mask.data() + e.offset;
+
+    // prefer the rarest pair of adjacent non-wildcard bytes
+    bool has_pair = false;
+    size_t best = 0;
+    for (size_t n = 0; n + 1 < e.size; ++n) {
+      if (!mask[n] || !mask[n + 1]) {
+        continue;
+      }
+
+      size_t frequency =
+          byte_frequency(bytes[n]) + byte_frequency(bytes[n + 1]);
+      if (!has_pair || frequency < best) {
+        e.anchor = n;
+        best = frequency;
+        has_pair = true;
+      }
+    }
+
+    if (!e.size) {
+      pair_keys.push_back(UINT32_MAX);
+      byte_keys.push_back(UINT32_MAX);
+    } else if (has_pair) {
+      pair_keys.push_back(bytes[e.anchor] | (bytes[e.anchor + 1] << 8));
+      byte_keys.push_back(UINT32_MAX);
+    } else {
+      size_t second_anchor = 0;
+      select_anchors(bytes, mask, e.size, e.anchor, second_anchor);
+      pair_keys.push_back(UINT32_MAX);
+      byte_keys.push_back(bytes[e.anchor]);
+    }
+
+    this->entries.push_back(e);
+  }
+
+  auto bucket = [](const std::vector<uint32_t>& keys,
+                   std::vector<uint32_t>& index,
+                   std::vector<uint32_t>& buckets) {
+    for (uint32_t key : keys) {
+      if (key != UINT32_MAX) {
+        ++index.at(key + 1);
+      }
+    }
+
+    for (size_t n = 1; n < index.size(); ++n) {
+      index.at(n) += index.at(n - 1);
+    }
+
+    buckets.resize(index.back());
+    std::vector<uint32_t> fill(index.begin(), index.end() - 1);
+    for (uint32_t n = 0; n < keys.size(); ++n) {
+      if (keys.at(n) != UINT32_MAX) {
+        buckets.at(fill.at(keys.at(n))++) = n;
+      }
+    }
+  };
+
+  bucket(pair_keys, this->pair_index, this->pair_buckets);
+  bucket(byte_keys, this->byte_index, this->byte_buckets);
+}
+
+std::vector<mnemosyne::pattern_set::match>
+mnemosyne::pattern_set::find_all() {
+  std::vector<match> matches;
+
+  this->scan([&matches](size_t pattern, uintptr_t address) {
+    matches.push_back({pattern, address});
+    return true;
+  });
+
+  std::sort(matches.begin(), matches.end(), [](const match& a, const match& b) {
+    return a.address != b.address ? a.address < b.address
+                                  : a.pattern < b.pattern;
+  });
+
+  return matches;
+}
+
+std::vector<uintptr_t> mnemosyne::pattern_set::find_addresses() {
+  std::vector<uintptr_t> addresses(this->entries.size(), 0);
+  size_t remaining = this->pair_buckets.size() + this->byte_buckets.size();
+
+  // an entry's candidates only ever increase, so its first hit is its lowest
+  this->scan([&](size_t pattern, uintptr_t address) {
+    if (!addresses.at(pattern)) {
+      addresses.at(pattern) = address;
+      --remaining;
+    }
+
+    return remaining != 0;
+  });
+
+  return addresses;
+}
+
+mnemosyne::pattern_set::pattern_set() {}
+
+bool mnemosyne::pattern_set::scan(
+    const std::function<bool(size_t, uintptr_t)>& callback) {
+  // bounds of the readable region being scanned, a match lies inside one
+  const uint8_t* start = nullptr;
+  const uint8_t* end = nullptr;
+
+  const uint32_t* pair_index = this->pair_index.data();
+  const uint32_t* pair_buckets = this->pair_buckets.data();
+  const uint32_t* byte_index = this->byte_index.data();
+  const uint32_t* byte_buckets = this->byte_buckets.data();
+  const bool has_byte_anchors = !this->byte_buckets.empty();
+
+  // verifies the entry anchored at `at` and reports it, false stops the scan
+  auto visit = [&](uint32_t n, const uint8_t* at) {
+    const entry& e = this->entries[n];
+
+    if (static_cast<size_t>(at - start) < e.anchor ||
+        static_cast<size_t>(end - (at - e.anchor)) < e.size) {
+      return true;
+    }
+
+    scan_pattern p = {this->bytearray.data() + e.offset,
+                      this->mask.data() + e.offset, e.size, e.anchor,
+                      e.anchor};
+    if (!verify_from(p, at - e.anchor, 0)) {
+      return true;
+    }
+
+    return callback(n, reinterpret_cast<uintptr_t>(at - e.anchor));
+  };
+
+  bool stopped = false;
+  bool completed = true;
+  auto sweep = [&]() {
+    for (const uint8_t* at = start; at < end; ++at) {
+      uint32_t key = *at;
+
+      if (has_byte_anchors) {
+        for (uint32_t n = byte_index[key]; n < byte_index[key + 1]; ++n) {
+          if (!visit(byte_buckets[n], at)) {
+            stopped = true;
+            return;
+          }
+        }
+      }
+
+      if (at + 1 == end) {
+        break;
+      }
+
+      key |= at[1] << 8;
+      for (uint32_t n = pair_index[key]; n < pair_index[key + 1]; ++n) {
+        if (!visit(pair_buckets[n], at)) {
+          stopped = true;
+          return;
+        }
+      }
+    }
+  };
+
+  // regions are merged when adjacent, so no match spans two of them. a
+  // page freed since the query only costs the rest of its region
+  for (const auto& region :
+       regions::readable(this->memory_start, this->memory_size)) {
+    start = reinterpret_cast<const uint8_t*>(region.start);
+    end = start + region.size;
+    completed &= platform::guarded(sweep);
+
+    if (stopped) {
+      break;
+    }
+  }
 
-  return j == this->pattern_size;
+  return completed && !stopped;
 }
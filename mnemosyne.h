@@ -1,34 +1,302 @@
 #pragma once
 #include <cstdint>
+#include <cstring>
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <functional>
+#include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
 #include <string>
+#include <type_traits>
+#include <unordered_map>
 #include <vector>
 
+#ifdef _WIN32
 #include <windows.h>
+#else
+#include <sys/uio.h>
+#endif
 
 namespace mnemosyne {
+struct memory_region {
+  uintptr_t start;
+  size_t size;
+  bool readable;
+  bool writable;
+  bool executable;
+};
+
+struct loaded_module {
+  // as taken by regions::module_range, empty for the main executable
+  std::string name;
+  memory_region range;
+};
+
+namespace regions {
+// committed regions overlapping [start, start + size), clipped to the range
+std::vector<memory_region> query(uintptr_t start, size_t size);
+// readable regions of query(), adjacent ones merged into a single region
+std::vector<memory_region> readable(uintptr_t start, size_t size);
+
+// image of a loaded module, the main executable if name is empty
+memory_region module_range(const std::string& name);
+// every loaded module, the main executable first
+std::vector<loaded_module> modules();
+// from the lowest to the highest mapped address of the process
+memory_region process_range();
+}  // namespace regions
+
+struct module_section {
+  // as in the image, e.g. .text, .rdata or .rodata, .data
+  std::string name;
+  memory_region range;
+};
+
+// loaded modules with their sections and exported symbols. a module is
+// parsed on the first lookup in it, symbols into a hash table, and all of
+// it is dropped when a module is loaded or unloaded
+class module_map {
+ public:
+  module_map();
+
+  module_map(const module_map&) = delete;
+  module_map& operator=(const module_map&) = delete;
+
+  // never destroyed, used by pattern_match::in_section
+  static module_map& shared();
+
+  // modules are named as for regions::module_range, empty for the main
+  // executable
+  std::vector<loaded_module> modules();
+  // sections mapped into memory, segments named .text, .rodata and .data
+  // when the section headers can not be read
+  std::vector<module_section> sections(const std::string& module);
+  // range of a section, empty if there is none by that name
+  memory_region section(const std::string& module, const std::string& name);
+  // exported function or variable, 0 if the module does not export it
+  uintptr_t symbol(const std::string& module, const std::string& name);
+
+  // parses everything again on the next lookup
+  void invalidate();
+
+ private:
+  struct entry {
+    loaded_module module;
+    // elf load bias, or pe image base
+    uintptr_t base;
+    std::string path;
+
+    bool parsed;
+    std::vector<module_section> sections;
+    // elf dynamic symbols and their default versions, from the sections
+    uintptr_t symbol_table;
+    size_t symbol_count;
+    uintptr_t string_table;
+    uintptr_t versions;
+
+    bool indexed;
+    std::unordered_map<std::string, uintptr_t> symbols;
+  };
+
+  std::vector<entry> entries;
+  std::unordered_map<std::string, size_t> by_name;
+  uint64_t generation;
+  bool listed;
+  std::mutex mutex;
+
+  // entry of module, listing modules again first if any were loaded or
+  // unloaded. null if it is not loaded
+  entry* find(const std::string& module);
+  void list();
+  void parse(entry& e);
+  void index(entry& e);
+};
+
+// operating system specifics, VirtualQuery/VirtualProtect and SEH on windows,
+// /proc/self/maps, mprotect and a SIGSEGV handler elsewhere
+namespace platform {
+size_t page_size();
+
+// region containing address. on linux this is served from a cached copy of
+// /proc/self/maps that is reparsed on a miss or after protect()
+bool query(uintptr_t address, memory_region& region);
+// sets the access of every page overlapping [address, address + size)
+bool protect(void* address,
+             size_t size,
+             bool readable,
+             bool writable,
+             bool executable);
+
+// pages made writable by make_writable, to be handed back to restore()
+struct protection_change {
+  void* address;
+  size_t size;
+  bool changed;
+};
+
+// makes [address, address + size) writable. protections are cached per page,
+// so pages known to be writable cost no system call. changed windows pages
+// become PAGE_EXECUTE_READWRITE, keeping PAGE_NOCACHE or PAGE_WRITECOMBINE,
+// elsewhere execute access is kept as is
+bool make_writable(void* address, size_t size, protection_change& change);
+// puts back the protection of the pages make_writable changed
+void restore(const protection_change& change);
+// drops cached protections, needed after they are changed outside of the
+// library
+void invalidate(void* address, size_t size);
+void invalidate();
+
+// runs callback, false if it faulted on a memory access. on linux the fault
+// unwinds with siglongjmp, so the callback must not own objects with
+// destructors
+bool guarded(const std::function<void(void)>& callback);
+// memcpy that returns false instead of faulting
+bool read(void* destination, const void* source, size_t size);
+bool write(void* destination, const void* source, size_t size);
+}  // namespace platform
+
+// non-owning view of in-process memory, valid while the pages stay mapped
+// and readable
+struct memory_view {
+  const uint8_t* data;
+  size_t size;
+
+  const uint8_t* begin() const { return this->data; }
+  const uint8_t* end() const { return this->data + this->size; }
+  uint8_t operator[](size_t n) const { return this->data[n]; }
+  bool empty() const { return !this->size; }
+};
+
+// memory that address and pattern_match operate on, the current process
+// when none is given
+class memory_source {
+ public:
+  struct request {
+    uintptr_t address;
+    void* buffer;
+    size_t size;
+  };
+
+  // results of a batched read and the arguments of its system calls, kept
+  // by the caller so that repeated batches allocate nothing once grown
+  struct batch {
+    std::vector<bool> results;
+#ifndef _WIN32
+    std::vector<iovec> local;
+    std::vector<iovec> remote;
+#endif
+  };
+
+  virtual ~memory_source();
+
+  // whether addresses can be dereferenced directly by this process
+  virtual bool in_process() const = 0;
+  virtual bool read(void* destination, uintptr_t source, size_t size) = 0;
+  virtual bool write(uintptr_t destination,
+                     const void* source,
+                     size_t size) = 0;
+  // readable regions overlapping [start, start + size), clipped to the range
+  // and adjacent ones merged
+  virtual std::vector<memory_region> readable(uintptr_t start,
+                                              size_t size) = 0;
+
+  // reads or writes every request, result n for request n. remote sources
+  // batch them into as few system calls as they can
+  virtual std::vector<bool> read_many(const std::vector<request>& requests);
+  virtual std::vector<bool> write_many(const std::vector<request>& requests);
+  // read_many with the results in into.results
+  virtual void read_many(const std::vector<request>& requests, batch& into);
+
+  // the bytes of [address, address + size) in this process if the source
+  // holds them contiguously, null if they have to be copied with read
+  virtual const uint8_t* in_place(uintptr_t address, size_t size);
+};
+
+// the current process, reads and writes are guarded against faults
+class local_source : public memory_source {
+ public:
+  static local_source& instance();
+
+  bool in_process() const override;
+  bool read(void* destination, uintptr_t source, size_t size) override;
+  bool write(uintptr_t destination, const void* source, size_t size) override;
+  std::vector<memory_region> readable(uintptr_t start, size_t size) override;
+};
+
+// another process by pid. needs the rights of a debugger over the target
+class remote_source : public memory_source {
+ public:
+  explicit remote_source(uint32_t pid);
+  ~remote_source();
+
+  remote_source(const remote_source&) = delete;
+  remote_source& operator=(const remote_source&) = delete;
+
+  uint32_t pid() const;
+  // false if the process could not be opened
+  bool attached() const;
+
+  bool in_process() const override;
+  bool read(void* destination, uintptr_t source, size_t size) override;
+  bool write(uintptr_t destination, const void* source, size_t size) override;
+  std::vector<memory_region> readable(uintptr_t start, size_t size) override;
+  using memory_source::read_many;
+  void read_many(const std::vector<request>& requests, batch& into) override;
+  std::vector<bool> write_many(const std::vector<request>& requests) override;
+
+ private:
+  uint32_t target;
+#ifdef _WIN32
+  HANDLE process;
+#else
+  // /proc/<pid>/mem, used for writes to pages the target can not write
+  int32_t memory_file;
+#endif
+};
+
+// outcome of address::read_available. pages[n] is whether the nth page
+// touched by the range, starting with the page holding its first byte,
+// could be read
+struct partial_read {
+  size_t bytes;
+  std::vector<bool> pages;
+};
+
 class address {
  public:
   address();
   address(void* ptr);
   address(uintptr_t intptr);
+  // an address in source, which must outlive the address
+  address(memory_source& source, uintptr_t intptr);
 
   void* as_ptr();
   uintptr_t as_int();
 
   const std::vector<uint8_t> read_memory(size_t size);
+  // copies size bytes into destination without allocating
+  bool read_into(void* destination, size_t size);
+  // copies every readable byte of [ptr, ptr + size) into destination and
+  // zero fills the rest. one guarded copy if all of it is readable, else one
+  // per readable region. never faults
+  partial_read read_available(void* destination, size_t size);
+  // [ptr, ptr + size) in place, empty unless every page of it is readable
+  memory_view view(size_t size);
   bool write_memory(const std::vector<uint8_t>& bytes);
 
-  bool copy_memory(void* bytes, size_t size);
+  bool copy_memory(const void* bytes, size_t size);
   bool fill_memory(uint8_t byte, size_t size);
+  // copies code into executable memory within rel32 reach of ptr, taken
+  // from code_arena::shared(). 0 if none could be mapped there
+  uintptr_t code_cave(const std::vector<uint8_t>& code);
 
   template <typename T>
   bool write(T data);
+  // T{} if the memory can not be read
   template <typename T>
   T read();
 
@@ -43,9 +311,482 @@ class address {
 
  private:
   void* ptr;
+  // null for the current process
+  memory_source* source;
+
+  bool remote() const;
+  // guarded reads and writes through the source, no protection change
+  bool read_raw(void* destination, uintptr_t source, size_t size);
+  bool write_raw(uintptr_t destination, const void* source, size_t size);
+
+  // runs callback with [ptr, ptr + size) writable, then restores the pages
+  // whose protection had to be changed
+  template <typename F>
+  bool with_page_execute_read_write(size_t size, F callback);
+};
 
-  std::function<bool(size_t, const std::function<bool(void)>&)>
-      with_page_execute_read_write;
+// a write caught by write_watch
+struct write_hit {
+  uintptr_t address;
+  // bytes from address the write changed, 0 if it stored the same bytes
+  size_t size;
+  uintptr_t instruction;
+  uint32_t thread;
+};
+
+// catches writes to [address, address + size) by making its pages read only.
+// a write fault inside the range is logged into a fixed ring buffer, then
+// the writer is single stepped with its page writable. writes to the rest of
+// the pages go through the same way without being logged. other threads may
+// write unseen while a write is being stepped. x86 only
+class write_watch {
+ public:
+  // capacity is rounded up to a power of two
+  write_watch(void* address, size_t size, size_t capacity = 1024);
+  ~write_watch();
+
+  write_watch(const write_watch&) = delete;
+  write_watch& operator=(const write_watch&) = delete;
+
+  // false if the cpu can not be single stepped, a page is already watched
+  // or can not be protected
+  bool arm();
+  void disarm();
+  bool armed() const;
+
+  // moves the logged hits into hits, oldest first, returns how many. only
+  // one thread may drain at a time
+  size_t drain(std::vector<write_hit>& hits);
+  // hits dropped because the buffer was full
+  size_t dropped() const;
+
+ private:
+  uintptr_t start;
+  size_t size;
+  uintptr_t first_page;
+  size_t page_count;
+  // native protection of every page before and while armed
+  std::vector<uint32_t> original;
+  std::vector<uint32_t> watched;
+  bool is_armed;
+  // set while disarming, faults then restore the page instead of stepping
+  std::atomic<bool> disarming;
+
+  // bounded multi producer queue, a slot is free for position p when its
+  // sequence is p and holds the hit at p when it is p + 1
+  std::vector<write_hit> ring;
+  std::unique_ptr<std::atomic<uint64_t>[]> sequence;
+  std::atomic<uint64_t> tail;
+  uint64_t head;
+  std::atomic<size_t> lost;
+
+  friend class watch_registry;
+
+  // called from the fault handlers, never allocates
+  void push(const write_hit& hit);
+};
+
+// writes applied together, with one protection change per contiguous span
+// of pages instead of one per write
+class write_batch {
+ public:
+  write_batch();
+
+  // queues a copy of the bytes, returns the index of the write in apply()
+  size_t add(address ptr, const std::vector<uint8_t>& bytes);
+  size_t add(void* destination, const void* bytes, size_t size);
+
+  // applies every queued write in the order added, then restores the
+  // protections it changed. the result of write n is at index n
+  std::vector<bool> apply();
+  void clear();
+  size_t size() const;
+
+ private:
+  struct entry {
+    uintptr_t address;
+    size_t offset;
+    size_t size;
+  };
+
+  std::vector<entry> entries;
+  std::vector<uint8_t> data;
+};
+
+// a multilevel pointer compiled once, walked like read_multilevel_ptr_val:
+// the pointer at base, then the pointer at p + offset for every offset but
+// the last, which leads to the value. the walk is cached and only redone
+// when the pointer at base changes or an access through it fails
+class pointer_chain {
+ public:
+  pointer_chain(uintptr_t base, const std::vector<size_t>& offsets);
+  // walks memory of source, which must outlive the chain
+  pointer_chain(memory_source& source,
+                uintptr_t base,
+                const std::vector<size_t>& offsets);
+
+  // address of the value, 0 if a level can not be read. one load while the
+  // pointer at base is unchanged
+  uintptr_t resolve();
+  // walks every level again, for changes below the base
+  uintptr_t refresh();
+  void invalidate();
+
+  template <typename T>
+  bool read(T& value);
+  template <typename T>
+  bool write(T value);
+
+ private:
+  memory_source* source;
+  uintptr_t base;
+  std::vector<size_t> offsets;
+  // pointer read at every level, pointers[0] is the one at base
+  std::vector<uintptr_t> pointers;
+  uintptr_t target;
+  bool cached;
+
+  bool load(void* destination, uintptr_t source, size_t size);
+  bool store(uintptr_t destination, const void* source, size_t size);
+  uintptr_t walk(uintptr_t root);
+  // resolves and accesses the value, walking again once if that fails
+  bool access(void* buffer, size_t size, bool is_write);
+};
+
+// pointer paths from module statics to an address, for feeding
+// pointer_chain. every pointer stored in writable memory of the process is
+// indexed once by the value it points to, so each level of a search is a
+// binary search instead of a rescan
+class pointer_scan {
+ public:
+  struct path {
+    std::string module;
+    // of the static holding the first pointer, from the module start
+    uintptr_t offset;
+    // as taken by pointer_chain
+    std::vector<size_t> offsets;
+
+    pointer_chain chain() const;
+  };
+
+  // takes the snapshot on up to `threads` threads (0 for one per core)
+  explicit pointer_scan(size_t threads = 0);
+
+  // paths of at most max_depth pointers, each pointing at most max_offset
+  // bytes below the next address, sorted by module and offset
+  std::vector<path> find_paths(uintptr_t target,
+                               size_t max_depth,
+                               size_t max_offset,
+                               size_t max_results = 10000);
+  // number of pointers indexed
+  size_t size() const;
+
+ private:
+  // sorted by value
+  std::vector<std::pair<uintptr_t, uintptr_t>> pointers;
+  std::vector<loaded_module> modules;
+  size_t threads;
+
+  const loaded_module* module_of(uintptr_t address) const;
+  void search(uintptr_t address,
+              size_t depth,
+              size_t max_offset,
+              size_t max_results,
+              std::vector<size_t>& offsets,
+              std::vector<path>& paths) const;
+};
+
+// copy of readable memory kept page by page with a hash of every page, so
+// a diff only compares the bytes of pages whose hash no longer matches
+class snapshot {
+ public:
+  struct range {
+    uintptr_t start;
+    size_t size;
+  };
+
+  // the readable pages of [start, start + size)
+  snapshot(uintptr_t start, size_t size);
+  explicit snapshot(const std::vector<memory_region>& regions);
+  static snapshot of_process();
+
+  // ranges of live memory that differ from the snapshot, a page that can
+  // no longer be read counts as changed
+  std::vector<range> diff() const;
+  // ranges that differ in a later snapshot, pages only one of the two holds
+  // count as changed
+  std::vector<range> diff(const snapshot& later) const;
+
+  // copies from the snapshot, false unless every byte was captured
+  bool read(uintptr_t address, void* destination, size_t size) const;
+  // bytes captured
+  size_t size() const;
+
+  // writes the snapshot for snapshot_file, identical pages stored once
+  bool save(const std::string& path) const;
+
+ private:
+  struct page {
+    uintptr_t address;
+    uint64_t hash;
+  };
+
+  // sorted by address, the bytes of page n start at n * page_size in data
+  std::vector<page> pages;
+  std::vector<uint8_t> data;
+  size_t page_size;
+
+  void capture(const std::vector<memory_region>& regions);
+  const uint8_t* bytes_of(size_t page) const;
+};
+
+// a file written by snapshot::save, mapped read only and scanned in place.
+// the system loads pages of it as they are touched. the layout is a
+// header, the region table, the stored page of every captured page, then
+// the page aligned stored pages
+class snapshot_file : public memory_source {
+ public:
+  explicit snapshot_file(const std::string& path);
+  ~snapshot_file();
+
+  snapshot_file(const snapshot_file&) = delete;
+  snapshot_file& operator=(const snapshot_file&) = delete;
+
+  // false if the file could not be mapped or is not a snapshot
+  bool loaded() const;
+  // captured and stored pages, fewer stored ones when pages were identical
+  size_t captured_pages() const;
+  size_t stored_pages() const;
+
+  bool in_process() const override;
+  bool read(void* destination, uintptr_t source, size_t size) override;
+  // the snapshot is read only
+  bool write(uintptr_t destination, const void* source, size_t size) override;
+  std::vector<memory_region> readable(uintptr_t start, size_t size) override;
+  const uint8_t* in_place(uintptr_t address, size_t size) override;
+
+ private:
+  struct header {
+    char magic[8];
+    uint32_t version;
+    uint32_t page_size;
+    uint64_t region_count;
+    uint64_t page_count;
+    uint64_t stored_count;
+    uint64_t data_offset;
+  };
+
+  struct region {
+    uint64_t start;
+    uint64_t pages;
+    // of the region's first page in the page index
+    uint64_t first;
+  };
+
+  const uint8_t* mapping;
+  size_t mapping_size;
+  const header* head;
+  const region* regions;
+  const uint64_t* page_index;
+#ifdef _WIN32
+  HANDLE file;
+  HANDLE file_mapping;
+#else
+  int32_t file;
+#endif
+
+  friend class snapshot;
+
+  bool map(const std::string& path);
+  void unmap();
+  // stored page holding address, null if it was not captured
+  const uint8_t* page_at(uintptr_t address) const;
+};
+
+// pages of a range written since the last collect, for incremental
+// rescans. on linux the soft dirty bits of /proc/self/pagemap are used and
+// cleared through /proc/self/clear_refs, otherwise every page is hashed and
+// compared with its hash at the last collect
+class dirty_pages {
+ public:
+  // soft dirty bits are used when prefer_soft_dirty is set, the kernel
+  // supports them and no other dirty_pages holds them, clearing them is
+  // process wide
+  dirty_pages(uintptr_t start, size_t size, bool prefer_soft_dirty = true);
+  ~dirty_pages();
+
+  dirty_pages(const dirty_pages&) = delete;
+  dirty_pages& operator=(const dirty_pages&) = delete;
+
+  // page ranges written, mapped or unmapped since the last collect, every
+  // readable page on the first. writes racing with a collect may be missed
+  std::vector<snapshot::range> collect();
+  bool soft_dirty() const;
+
+ private:
+  struct page {
+    uintptr_t address;
+    uint64_t hash;
+  };
+
+  uintptr_t start;
+  size_t size;
+  bool kernel;
+  bool collected;
+  // readable pages at the last collect in address order, hashed unless the
+  // soft dirty bits are used
+  std::vector<page> pages;
+
+  // marks the pages of current the kernel saw written since the bits were
+  // last cleared, false if pagemap could not be read
+  bool read_soft_dirty(const std::vector<page>& current,
+                       std::vector<bool>& written) const;
+};
+
+// candidates of a value_scan, for values of any size. kept per 64 KiB block
+// of address space as a bitmap when dense or a sorted array of slots when
+// sparse, along with the value each held at the last scan
+class value_candidates {
+ public:
+  // whether a candidate survives, given its bytes now and at the last scan
+  using predicate = bool (*)(const void* current,
+                             const void* previous,
+                             const void* value);
+
+  // only addresses that are a multiple of alignment are considered
+  value_candidates(uintptr_t memory_start,
+                   size_t memory_size,
+                   size_t value_size,
+                   size_t alignment);
+
+  // every readable location holding value, replacing the candidates
+  size_t first_scan(const void* value);
+  // reads only the candidates and keeps those passing keep
+  size_t next_scan(predicate keep, const void* value);
+  // first_scan again given the ranges written since the candidates were
+  // last read: candidates there are dropped and only those ranges searched
+  size_t rescan(const void* value, const std::vector<snapshot::range>& dirty);
+  size_t size() const;
+  std::vector<uintptr_t> addresses(size_t limit) const;
+  // value at the last scan, false if address is not a candidate
+  bool previous(uintptr_t address, void* value) const;
+
+ private:
+  struct block {
+    uintptr_t start;
+    size_t count;
+    // one bit per slot when dense, empty when sparse
+    std::vector<uint64_t> bits;
+    // slots of the candidates in order when sparse
+    std::vector<uint16_t> slots;
+    // value_size bytes per candidate, in slot order
+    std::vector<uint8_t> values;
+  };
+
+  uintptr_t memory_start;
+  size_t memory_size;
+  size_t value_size;
+  size_t alignment;
+  std::vector<block> blocks;
+
+  size_t slots_per_block() const;
+  // blocks of every location in regions holding value
+  std::vector<block> find(const std::vector<memory_region>& regions,
+                          const void* value) const;
+  // stores the slots of a block as whichever of bits and slots is smaller
+  void pack(block& b, const std::vector<uint16_t>& slots) const;
+  template <typename F>
+  void for_each_slot(const block& b, F callback) const;
+};
+
+// cheat engine style search for a value of type T: find every location
+// holding a value, then narrow the candidates scan by scan
+template <typename T>
+class value_scan {
+ public:
+  enum class compare { equals, changed, unchanged, increased, decreased };
+
+  // aligned scans only consider addresses that are a multiple of sizeof(T)
+  value_scan(void* memory_start, size_t memory_size, bool aligned = true);
+  static value_scan in_process(bool aligned = true);
+
+  size_t first_scan(T value);
+  // value is only used by compare::equals
+  size_t next_scan(compare how, T value = T{});
+  // the result of first_scan(value), scanning only the dirty ranges, for
+  // memory written since the candidates were last read
+  size_t rescan(T value, const std::vector<snapshot::range>& dirty);
+  size_t size() const;
+  std::vector<uintptr_t> addresses(size_t limit = SIZE_MAX) const;
+
+ private:
+  static_assert(std::is_trivially_copyable<T>::value,
+                "value_scan requires a trivially copyable T");
+
+  value_candidates candidates;
+
+  static T load(const void* bytes);
+  static bool equals(const void* current, const void*, const void* value);
+  static bool changed(const void* current, const void* previous, const void*);
+  static bool unchanged(const void* current,
+                        const void* previous,
+                        const void*);
+  static bool increased(const void* current,
+                        const void* previous,
+                        const void*);
+  static bool decreased(const void* current,
+                        const void* previous,
+                        const void*);
+};
+
+// reads registered once and executed every tick. nearby reads are merged
+// into one bulk copy, or one batched call for a remote source, and the
+// bytes scattered into the destinations
+class read_plan {
+ public:
+  // reads at most max_gap bytes apart are merged into one copy
+  explicit read_plan(size_t max_gap = 64);
+  // reads from source, which must outlive the plan
+  explicit read_plan(memory_source& source, size_t max_gap = 64);
+
+  // destination must stay valid while the plan is in use, returns the index
+  // of the read
+  size_t add(uintptr_t address, void* destination, size_t size);
+  template <typename T>
+  size_t add(uintptr_t address, T* destination);
+
+  // performs every read, returns how many succeeded. nothing is allocated
+  // after the first execute unless reads are added
+  size_t execute();
+  // whether read n succeeded in the last execute
+  bool succeeded(size_t index) const;
+  size_t size() const;
+  void clear();
+
+ private:
+  struct entry {
+    uintptr_t address;
+    void* destination;
+    size_t size;
+    size_t span;
+    // of the first byte in staging
+    size_t offset;
+  };
+
+  memory_source* source;
+  size_t max_gap;
+  bool planned;
+
+  std::vector<entry> entries;
+  // merged reads into staging, in address order
+  std::vector<memory_source::request> spans;
+  std::vector<uint8_t> staging;
+  // results of the spans, with the buffers of a batched remote read
+  memory_source::batch span_batch;
+  std::vector<bool> results;
+
+  void plan();
+  bool read_span(size_t span);
 };
 
 class memory_edit {
@@ -61,6 +802,10 @@ class memory_patch : public memory_edit {
   bool edit();
   bool revert();
 
+  // queue the write into batch instead, returning its index in the batch
+  size_t edit(write_batch& batch);
+  size_t revert(write_batch& batch);
+
  private:
   address ptr;
   std::vector<uint8_t> replace_bytes;
@@ -77,6 +822,10 @@ class memory_data_edit : public memory_edit {
   bool edit();
   bool revert();
 
+  // queue the write into batch instead, returning its index in the batch
+  size_t edit(write_batch& batch);
+  size_t revert(write_batch& batch);
+
  private:
   address ptr;
   T replace_data;
@@ -85,6 +834,10 @@ class memory_data_edit : public memory_edit {
   memory_data_edit();
 };
 
+// redirects the function *ptr points at to `to`, and points *ptr at a
+// trampoline calling the original. detours on windows, an inline hook on
+// x86-64 linux: the prologue is relocated next to the function and
+// replaced with a jump while other threads keep running
 class memory_redirect : public memory_edit {
  public:
   memory_redirect(void** ptr, void* to);
@@ -101,18 +854,230 @@ class memory_redirect : public memory_edit {
 
   std::function<bool(void**, void*, bool)> detours;
 
+  friend class redirect_batch;
+
   memory_redirect();
 };
 
+// redirects attached or detached together in one detours transaction, which
+// suspends and updates every other thread of the process once for all of
+// them. if any redirect fails the transaction is aborted and none change
+class redirect_batch {
+ public:
+  redirect_batch();
+
+  // queues the redirect, returns its index in the batch
+  size_t add(const memory_redirect& redirect);
+
+  bool attach();
+  bool detach();
+  void clear();
+  size_t size() const;
+
+ private:
+  struct entry {
+    void** ptr;
+    void* to;
+  };
+
+  std::vector<entry> entries;
+
+  bool commit(bool enable);
+};
+
+// redirects calls of an imported function by rewriting the import address
+// table entries on windows, or the got entries elsewhere, of every loaded
+// module. one pointer write per entry, no trampoline and no threads
+// suspended. modules loaded after edit() keep calling the original, which
+// the replacement should call through original() rather than by name
+class table_redirect : public memory_edit {
+ public:
+  // library exports symbol. on windows only imports from library are
+  // rewritten, elsewhere every got entry for symbol is, and library only
+  // picks the definition original() resolves, the global one if empty
+  table_redirect(const std::string& library,
+                 const std::string& symbol,
+                 void* to);
+
+  // true if at least one entry was rewritten
+  bool edit();
+  // puts back the entries that still point to the replacement
+  bool revert();
+
+  // the function the entries pointed to, resolved by edit()
+  void* original() const;
+  // entries rewritten by the last edit()
+  size_t entries() const;
+
+ private:
+  struct entry {
+    void** slot;
+    void* previous;
+  };
+
+  std::string library;
+  std::string symbol;
+  void* to;
+  void* resolved;
+  std::vector<entry> rewritten;
+};
+
+// executable memory for trampolines and code caves, handed out in 16 byte
+// aligned slots from slabs mapped within rel32 reach of the code that jumps
+// to them. slabs are read only and executable, the pages of a slot being
+// written are read write instead, so no other slot on them may run meanwhile
+class code_arena {
+ public:
+  explicit code_arena(size_t slab_size = 0x10000);
+  // unmaps every slab
+  ~code_arena();
+
+  code_arena(const code_arena&) = delete;
+  code_arena& operator=(const code_arena&) = delete;
+
+  // never destroyed, used by memory_redirect and address::code_cave
+  static code_arena& shared();
+
+  // size bytes within 2 GiB of target, 0 if no room could be mapped there
+  uintptr_t allocate(uintptr_t target, size_t size);
+  // copies code into an allocated slot, false if it does not fit
+  bool write(uintptr_t slot, const void* code, size_t size);
+  void release(uintptr_t slot);
+  // unmaps every slab at once, no code in the arena may run afterwards
+  void release_all();
+
+  // bytes handed out, and mapped for slots
+  size_t used() const;
+  size_t reserved() const;
+
+ private:
+  static constexpr size_t slot_alignment = 16;
+
+  struct span {
+    size_t offset;
+    size_t size;
+  };
+
+  struct slab {
+    uintptr_t start;
+    size_t size;
+    // in offset order, adjacent spans are joined
+    std::vector<span> free;
+  };
+
+  size_t slab_size;
+  std::vector<slab> slabs;
+  // size of every slot handed out, by address
+  std::unordered_map<uintptr_t, size_t> slots;
+  mutable std::mutex mutex;
+};
+
+// counts the calls of a function and times them with the time stamp
+// counter. an entry thunk, installed through memory_redirect, swaps the
+// return address for an exit thunk. every thread counts into blocks of its
+// own without locks or atomic read-modify-writes, summed by collect(). a
+// probed function tail called by another is counted, its time is part of
+// the caller's. x86-64 only, exceptions must not unwind through a probed
+// function
+class probe {
+ public:
+  // power of two ranges of ticks split in 8, ticks below 16 exact
+  static constexpr size_t bucket_count = 16 + 44 * 8;
+
+  struct statistics {
+    uint64_t calls;
+    // calls that returned, running ones and those nested too deep are not
+    uint64_t timed;
+    uint64_t total_ticks;
+    std::vector<uint64_t> histogram;
+
+    // ticks of the q quantile of the timed calls, 0 <= q <= 1, rounded up
+    // to the end of its bucket
+    uint64_t percentile(double q) const;
+  };
+
+  explicit probe(void* function);
+  // detaches. the thunks and counters stay allocated, a thread may still
+  // return through them
+  ~probe();
+
+  probe(const probe&) = delete;
+  probe& operator=(const probe&) = delete;
+
+  bool attach();
+  bool detach();
+  bool attached() const;
+  statistics collect() const;
+
+  static size_t bucket_of(uint64_t ticks);
+  // first tick count of the bucket
+  static uint64_t bucket_start(size_t bucket);
+  // measured once against the steady clock
+  static uint64_t ticks_per_second();
+
+ private:
+  struct state;
+
+  state* shared;
+
+  friend class probe_runtime;
+};
+
+// parsed pattern bytes, mask is 0xff where the byte must match and 0x00 for ??
+struct pattern_view {
+  const uint8_t* bytes;
+  const uint8_t* mask;
+  size_t size;
+};
+
 class pattern_match {
  public:
+  enum class scan_engine { scalar, sse2, avx2 };
+
   pattern_match(const std::string& pattern,
                 void* memory_start,
                 size_t memory_size);
+  // the bytes are not copied and must outlive the pattern_match. a pattern
+  // of wildcards only never matches
+  pattern_match(const pattern_view& pattern,
+                void* memory_start,
+                size_t memory_size);
+  // scans memory of source, which must outlive the pattern_match
+  pattern_match(const std::string& pattern,
+                memory_source& source,
+                uintptr_t memory_start,
+                size_t memory_size);
+
+  // scans a whole module, the main executable if module is empty
+  static pattern_match in_module(const std::string& pattern,
+                                 const std::string& module = "");
+  static pattern_match in_process(const std::string& pattern);
+  // scans a section of a module, looked up in module_map::shared()
+  static pattern_match in_section(const std::string& pattern,
+                                  const std::string& module,
+                                  const std::string& section);
 
+  // only readable pages of the range are scanned, a match may span adjacent
+  // regions
   uintptr_t find_address();
   uintptr_t find_next_address();
 
+  // scans chunks of the range on up to `threads` threads (0 for one per
+  // core), same result as find_address
+  uintptr_t find_address_parallel(size_t threads = 0);
+  // every match in address order, scanned like find_address_parallel
+  std::vector<uintptr_t> find_all(size_t threads = 0);
+  // find_all again given its previous result and the ranges written since,
+  // only matches that could overlap the dirty ranges are scanned for
+  std::vector<uintptr_t> rescan(const std::vector<uintptr_t>& previous,
+                                const std::vector<snapshot::range>& dirty,
+                                size_t threads = 0);
+
+  // widest engine supported by the running cpu, used by default
+  static scan_engine best_engine();
+  // falls back to the best supported engine if the cpu lacks the requested one
+  void use_engine(scan_engine engine);
+
  private:
   std::string pattern;
   size_t pattern_size;
@@ -120,15 +1085,107 @@ class pattern_match {
   uintptr_t memory_start;
   size_t memory_size;
   uintptr_t current_address;
+  // readable parts of the range, refreshed by every scan from the start
+  std::vector<memory_region> regions;
+  // null for the current process
+  memory_source* source;
+  // distinct for every refresh of regions, keys chunks copied from source
+  uint64_t generation;
 
   std::vector<uint8_t> bytearray;
+  // 0xff where the byte must match, 0x00 for ??
   std::vector<uint8_t> mask;
+  // bytes of a compiled_pattern, used when bytearray is empty
+  pattern_view borrowed;
+
+  // offsets of the two rarest non-wildcard bytes, compared first
+  size_t anchor;
+  size_t second_anchor;
+  scan_engine engine;
 
   pattern_match();
 
+  pattern_view view() const;
+  void refresh_regions();
+  uintptr_t scan_from(uintptr_t address);
+  uintptr_t scan_range(uintptr_t first, uintptr_t last, bool& faulted);
+  // every match in the chunks of regions, in address order
+  std::vector<uintptr_t> scan_all(const std::vector<memory_region>& regions,
+                                  size_t threads);
   bool try_match_at_current_address();
 };
 
+// a pattern parsed at compile time from a string literal, in the syntax of
+// pattern_match, that can be scanned against any number of ranges:
+//   static constexpr mnemosyne::compiled_pattern pattern("48 8b ?? c3");
+// malformed patterns have size 0 and never match
+template <size_t N>
+class compiled_pattern {
+ public:
+  constexpr compiled_pattern(const char (&pattern)[N]);
+
+  constexpr size_t size() const;
+  constexpr uint8_t byte_at(size_t n) const;
+  constexpr bool is_wildcard(size_t n) const;
+
+  pattern_view view() const;
+
+  uintptr_t find_address(void* memory_start, size_t memory_size) const;
+  std::vector<uintptr_t> find_all(void* memory_start,
+                                  size_t memory_size,
+                                  size_t threads = 0) const;
+
+ private:
+  // every byte takes at least two characters
+  uint8_t bytearray[N / 2 + 1];
+  uint8_t mask[N / 2 + 1];
+  size_t pattern_size;
+};
+
+class pattern_set {
+ public:
+  struct match {
+    size_t pattern;
+    uintptr_t address;
+  };
+
+  pattern_set(const std::vector<std::string>& patterns,
+              void* memory_start,
+              size_t memory_size);
+
+  // every match of every pattern ordered by address, found in a single pass
+  std::vector<match> find_all();
+  // first address of each pattern in the order given, 0 if not found
+  std::vector<uintptr_t> find_addresses();
+
+ private:
+  struct entry {
+    size_t offset;
+    size_t size;
+    size_t anchor;
+  };
+
+  uintptr_t memory_start;
+  size_t memory_size;
+
+  // bytes and masks of all patterns back to back, see entry::offset
+  std::vector<uint8_t> bytearray;
+  std::vector<uint8_t> mask;
+  std::vector<entry> entries;
+
+  // entries bucketed by their anchor, either two adjacent bytes or a single
+  // byte for patterns without two adjacent non-wildcard bytes. bucket n is
+  // buckets[index[n]] to buckets[index[n + 1]]
+  std::vector<uint32_t> pair_index;
+  std::vector<uint32_t> pair_buckets;
+  std::vector<uint32_t> byte_index;
+  std::vector<uint32_t> byte_buckets;
+
+  pattern_set();
+
+  bool scan(const std::function<bool(size_t, uintptr_t)>& callback);
+};
+
 namespace util {
 const std::string byte_to_string(const std::vector<uint8_t>& bytes,
                                  const std::string& separator = " ");
@@ -137,6 +1194,58 @@ const std::vector<uint8_t> string_to_bytes(std::string byte_string);
 template <typename T>
 T to(const std::vector<uint8_t>& bytes);
 
+// value of a hexadecimal digit, -1 if chr is not one
+constexpr int32_t hex_value(char chr) {
+  return chr >= '0' && chr <= '9'   ? chr - '0'
+         : chr >= 'a' && chr <= 'f' ? chr - 'a' + 10
+         : chr >= 'A' && chr <= 'F' ? chr - 'A' + 10
+                                    : -1;
+}
+
+// the bytes of a pattern in the syntax of pattern_match. bytes and mask need
+// room for length / 2 entries. trailing whitespaces and ? are trimmed and
+// the other whitespaces dropped, a byte may be split by them. returns the
+// number of bytes, 0 if the pattern is malformed
+constexpr size_t parse_pattern(const char* pattern,
+                               size_t length,
+                               uint8_t* bytes,
+                               uint8_t* mask) {
+  while (length && (pattern[length - 1] == ' ' || pattern[length - 1] == '?')) {
+    --length;
+  }
+
+  size_t size = 0;
+  char high = 0;
+  bool pending = false;
+
+  for (size_t n = 0; n < length; ++n) {
+    if (pattern[n] == ' ') {
+      continue;
+    }
+
+    pending = !pending;
+    if (pending) {
+      high = pattern[n];
+      continue;
+    }
+
+    const char low = pattern[n];
+    if (high == '?' && low == '?') {
+      bytes[size] = 0;
+      mask[size] = 0x00;
+    } else if (hex_value(high) >= 0 && hex_value(low) >= 0) {
+      bytes[size] = static_cast<uint8_t>(hex_value(high) << 4 | hex_value(low));
+      mask[size] = 0xff;
+    } else {
+      return 0;
+    }
+
+    ++size;
+  }
+
+  return pending ? 0 : size;
+}
+
 template <typename T>
 inline T to(const std::vector<uint8_t>& bytes) {
   std::vector<uint8_t> b = bytes;
@@ -154,8 +1263,34 @@ inline T to(const std::vector<uint8_t>& bytes) {
 }
 }  // namespace util
 
+template <typename F>
+inline bool address::with_page_execute_read_write(size_t size, F callback) {
+  bool result = false;
+
+  for (int32_t attempt = 0; attempt < 2; ++attempt) {
+    platform::protection_change change = {nullptr, 0, false};
+    platform::make_writable(this->ptr, size, change);
+
+    bool completed = platform::guarded([&]() { result = callback(); });
+    platform::restore(change);
+
+    if (completed) {
+      return result;
+    }
+
+    // the cached protection was stale, ask the system again
+    platform::invalidate(this->ptr, size);
+  }
+
+  return false;
+}
+
 template <typename T>
 inline bool address::write(T data) {
+  if (this->remote()) {
+    return this->write_raw(this->as_int(), &data, sizeof(T));
+  }
+
   return this->with_page_execute_read_write(sizeof(T), [&]() {
     *reinterpret_cast<T*>(this->ptr) = data;
     return true;
@@ -164,33 +1299,37 @@ inline bool address::write(T data) {
 
 template <typename T>
 inline T address::read() {
-  return util::to<T>(this->read_memory(sizeof(T)));
+  static_assert(std::is_trivially_copyable<T>::value,
+                "read<T> requires a trivially copyable T");
+
+  T value{};
+  if (!this->read_into(&value, sizeof(T))) {
+    return T{};
+  }
+
+  return value;
 }
 
 template <typename T>
 inline bool address::write_ptr_val(size_t offset, T value) {
-  if (!this->ptr) {
-    return false;
-  }
+  uintptr_t base = 0;
 
-  __try {
-    *reinterpret_cast<T*>(*reinterpret_cast<uintptr_t*>(this->ptr) + offset) =
-        value;
-    return true;
-  } __except (EXCEPTION_EXECUTE_HANDLER) {
-    return false;
-  }
+  return this->ptr &&
+         this->read_raw(&base, this->as_int(), sizeof(uintptr_t)) &&
+         this->write_raw(base + offset, &value, sizeof(T));
 }
 
 template <typename T>
 inline T address::read_ptr_val(size_t offset) {
-  __try {
-    return this->ptr ? *reinterpret_cast<T*>(
-                           *reinterpret_cast<uintptr_t*>(this->ptr) + offset)
-                     : 0;
-  } __except (EXCEPTION_EXECUTE_HANDLER) {
+  uintptr_t base = 0;
+  T value = 0;
+
+  if (!this->ptr || !this->read_raw(&base, this->as_int(), sizeof(uintptr_t)) ||
+      !this->read_raw(&value, base + offset, sizeof(T))) {
     return 0;
   }
+
+  return value;
 }
 
 template <typename T>
@@ -198,48 +1337,92 @@ inline bool address::write_multilevel_ptr_val(std::queue<size_t> offsets,
                                               T value) {
   uintptr_t base = this->as_int();
 
-  if (!base) {
+  if (!base || offsets.empty() ||
+      !this->read_raw(&base, base, sizeof(uintptr_t))) {
     return false;
   }
 
-  for (base = *reinterpret_cast<uintptr_t*>(base); !offsets.empty();
-       offsets.pop()) {
-    if (offsets.size() == 1) {
-      *reinterpret_cast<T*>(base + offsets.front()) = value;
-      return true;
-    } else {
-      // the for loop deref our base
-      base = *reinterpret_cast<uintptr_t*>(base + offsets.front());
+  // every offset but the last leads to the next pointer
+  for (; offsets.size() > 1; offsets.pop()) {
+    if (!this->read_raw(&base, base + offsets.front(), sizeof(uintptr_t))) {
+      return false;
     }
   }
 
-  return false;
+  return this->write_raw(base + offsets.front(), &value, sizeof(T));
 }
 
 template <typename T>
 inline T address::read_multilevel_ptr_val(std::queue<size_t> offsets) {
   uintptr_t base = this->as_int();
+  T value = 0;
 
-  if (!base) {
+  if (!base || offsets.empty() ||
+      !this->read_raw(&base, base, sizeof(uintptr_t))) {
     return 0;
   }
 
-  for (base = *reinterpret_cast<uintptr_t*>(base); !offsets.empty();
-       offsets.pop()) {
-    if (offsets.size() == 1) {
-      return *reinterpret_cast<T*>(base + offsets.front());
-    } else {
-      // the for loop deref our base
-      base = *reinterpret_cast<uintptr_t*>(base + offsets.front());
+  for (; offsets.size() > 1; offsets.pop()) {
+    if (!this->read_raw(&base, base + offsets.front(), sizeof(uintptr_t))) {
+      return 0;
     }
   }
 
-  return 0;
+  if (!this->read_raw(&value, base + offsets.front(), sizeof(T))) {
+    return 0;
+  }
+
+  return value;
 }
 
-template <typename T>
-inline static memory_redirect memory_redirect::from(T* ptr, T to) {
-  return memory_redirect(reinterpret_cast<void**>(ptr), to);
+template <size_t N>
+inline constexpr compiled_pattern<N>::compiled_pattern(
+    const char (&pattern)[N])
+    : bytearray(), mask(), pattern_size(0) {
+  // the literal ends in its terminator
+  size_t length = 0;
+  while (length < N && pattern[length]) {
+    ++length;
+  }
+
+  this->pattern_size =
+      util::parse_pattern(pattern, length, this->bytearray, this->mask);
+}
+
+template <size_t N>
+inline constexpr size_t compiled_pattern<N>::size() const {
+  return this->pattern_size;
+}
+
+template <size_t N>
+inline constexpr uint8_t compiled_pattern<N>::byte_at(size_t n) const {
+  return this->bytearray[n];
+}
+
+template <size_t N>
+inline constexpr bool compiled_pattern<N>::is_wildcard(size_t n) const {
+  return !this->mask[n];
+}
+
+template <size_t N>
+inline pattern_view compiled_pattern<N>::view() const {
+  return {this->bytearray, this->mask, this->pattern_size};
+}
+
+template <size_t N>
+inline uintptr_t compiled_pattern<N>::find_address(void* memory_start,
+                                                   size_t memory_size) const {
+  return pattern_match(this->view(), memory_start, memory_size)
+      .find_address();
+}
+
+template <size_t N>
+inline std::vector<uintptr_t> compiled_pattern<N>::find_all(
+    void* memory_start,
+    size_t memory_size,
+    size_t threads) const {
+  return pattern_match(this->view(), memory_start, memory_size)
+      .find_all(threads);
 }
 
 template <class T>
@@ -258,6 +1441,141 @@ inline bool memory_data_edit<T>::revert() {
   return this->ptr.write<T>(this->retain_data);
 }
 
+template <typename T>
+inline bool pointer_chain::read(T& value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "pointer_chain::read requires a trivially copyable T");
+  return this->access(&value, sizeof(T), false);
+}
+
+template <typename T>
+inline bool pointer_chain::write(T value) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "pointer_chain::write requires a trivially copyable T");
+  return this->access(&value, sizeof(T), true);
+}
+
+template <typename T>
+inline value_scan<T>::value_scan(void* memory_start,
+                                 size_t memory_size,
+                                 bool aligned)
+    : candidates(reinterpret_cast<uintptr_t>(memory_start),
+                 memory_size,
+                 sizeof(T),
+                 aligned ? sizeof(T) : 1) {}
+
+template <typename T>
+inline value_scan<T> value_scan<T>::in_process(bool aligned) {
+  memory_region range = regions::process_range();
+  return value_scan(reinterpret_cast<void*>(range.start), range.size,
+                    aligned);
+}
+
+template <typename T>
+inline size_t value_scan<T>::first_scan(T value) {
+  return this->candidates.first_scan(&value);
+}
+
+template <typename T>
+inline size_t value_scan<T>::next_scan(compare how, T value) {
+  switch (how) {
+    case compare::equals:
+      return this->candidates.next_scan(&value_scan::equals, &value);
+    case compare::changed:
+      return this->candidates.next_scan(&value_scan::changed, &value);
+    case compare::unchanged:
+      return this->candidates.next_scan(&value_scan::unchanged, &value);
+    case compare::increased:
+      return this->candidates.next_scan(&value_scan::increased, &value);
+    case compare::decreased:
+      return this->candidates.next_scan(&value_scan::decreased, &value);
+  }
+
+  return this->size();
+}
+
+template <typename T>
+inline size_t value_scan<T>::rescan(
+    T value,
+    const std::vector<snapshot::range>& dirty) {
+  return this->candidates.rescan(&value, dirty);
+}
+
+template <typename T>
+inline size_t value_scan<T>::size() const {
+  return this->candidates.size();
+}
+
+template <typename T>
+inline std::vector<uintptr_t> value_scan<T>::addresses(size_t limit) const {
+  return this->candidates.addresses(limit);
+}
+
+template <typename T>
+inline T value_scan<T>::load(const void* bytes) {
+  T value;
+  memcpy(&value, bytes, sizeof(T));
+  return value;
+}
+
+template <typename T>
+inline bool value_scan<T>::equals(const void* current,
+                                  const void*,
+                                  const void* value) {
+  return load(current) == load(value);
+}
+
+template <typename T>
+inline bool value_scan<T>::changed(const void* current,
+                                   const void* previous,
+                                   const void*) {
+  return memcmp(current, previous, sizeof(T)) != 0;
+}
+
+template <typename T>
+inline bool value_scan<T>::unchanged(const void* current,
+                                     const void* previous,
+                                     const void*) {
+  return memcmp(current, previous, sizeof(T)) == 0;
+}
+
+template <typename T>
+inline bool value_scan<T>::increased(const void* current,
+                                     const void* previous,
+                                     const void*) {
+  return load(current) > load(previous);
+}
+
+template <typename T>
+inline bool value_scan<T>::decreased(const void* current,
+                                     const void* previous,
+                                     const void*) {
+  return load(current) < load(previous);
+}
+
+template <typename T>
+inline size_t read_plan::add(uintptr_t address, T* destination) {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "read_plan::add requires a trivially copyable T");
+  return this->add(address, destination, sizeof(T));
+}
+
+template <class T>
+inline size_t memory_data_edit<T>::edit(write_batch& batch) {
+  return batch.add(this->ptr.as_ptr(), &this->replace_data, sizeof(T));
+}
+
+template <class T>
+inline size_t memory_data_edit<T>::revert(write_batch& batch) {
+  return batch.add(this->ptr.as_ptr(), &this->retain_data, sizeof(T));
+}
+
 template <class T>
 inline memory_data_edit<T>::memory_data_edit() {}
+
+template <typename T>
+inline memory_redirect memory_redirect::from(T* ptr, T to) {
+  return memory_redirect(reinterpret_cast<void**>(ptr),
+                         reinterpret_cast<void*>(to));
+}
 }  // namespace mnemosyne
\ No newline at end of file
@@ -2,6 +2,10 @@
 
 #include <gtest/gtest.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
 #ifdef _WIN64
 #pragma comment(lib, "mnemosyne.lib")
 #pragma comment(lib, "detours64.lib")
@@ -78,6 +82,125 @@ TEST(address_unittest, test_address_read) {
   EXPECT_EQ(0x12345678deadbeef, mnemosyne::address(&n).read<uint64_t>());
 }
 
+TEST(address_unittest, test_address_read_trivially_copyable) {
+  struct test_struct {
+    uint16_t a;
+    float b;
+    double c;
+  };
+
+  test_struct obj = {0xbeef, 1.5f, -2.25};
+  test_struct actual = mnemosyne::address(&obj).read<test_struct>();
+  EXPECT_EQ(0xbeef, actual.a);
+  EXPECT_EQ(1.5f, actual.b);
+  EXPECT_EQ(-2.25, actual.c);
+
+  EXPECT_EQ(1.5f, mnemosyne::address(&obj.b).read<float>());
+  EXPECT_EQ(0, mnemosyne::address(0x10).read<uint32_t>());
+}
+
+TEST(address_unittest, test_address_read_into) {
+  uint64_t n = 0x12345678deadbeef;
+  uint32_t actual = 0;
+
+  EXPECT_TRUE(mnemosyne::address(&n).read_into(&actual, sizeof(actual)));
+  EXPECT_EQ(0xdeadbeef, actual);
+  EXPECT_FALSE(mnemosyne::address(0x10).read_into(&actual, sizeof(actual)));
+}
+
+TEST(address_unittest, test_address_view) {
+  uint8_t bytes[] = {0x11, 0x22, 0x33, 0x44};
+
+  mnemosyne::memory_view view = mnemosyne::address(bytes).view(sizeof(bytes));
+  EXPECT_EQ(bytes, view.data);
+  EXPECT_EQ(sizeof(bytes), view.size);
+  EXPECT_EQ(0x33, view[2]);
+  EXPECT_EQ(std::vector<uint8_t>(bytes, bytes + sizeof(bytes)),
+            std::vector<uint8_t>(view.begin(), view.end()));
+
+  EXPECT_TRUE(mnemosyne::address(0x10).view(4).empty());
+  EXPECT_TRUE(mnemosyne::address(nullptr).view(4).empty());
+}
+
+TEST(address_unittest, test_address_write_read_only_page) {
+#ifdef _WIN32
+  auto page = static_cast<uint32_t*>(
+      VirtualAlloc(nullptr, 0x1000, MEM_COMMIT | MEM_RESERVE, PAGE_READONLY));
+#else
+  auto page = static_cast<uint32_t*>(mmap(
+      nullptr, 0x1000, PROT_READ, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+
+  EXPECT_TRUE(mnemosyne::address(page + 1).write<uint32_t>(0xdeadbeef));
+  EXPECT_EQ(0xdeadbeef, page[1]);
+  EXPECT_EQ(0xdeadbeef, mnemosyne::address(page + 1).read<uint32_t>());
+
+  // the original protection is put back after the write
+  mnemosyne::memory_region region = {0, 0, false, false, false};
+  EXPECT_TRUE(
+      mnemosyne::platform::query(reinterpret_cast<uintptr_t>(page), region));
+  EXPECT_TRUE(region.readable);
+  EXPECT_FALSE(region.writable);
+
+  EXPECT_TRUE(mnemosyne::address(page).fill_memory(0x90, 4));
+  EXPECT_EQ(0x90909090, page[0]);
+  EXPECT_EQ(0x1000, mnemosyne::address(page).view(0x1000).size);
+
+#ifdef _WIN32
+  VirtualFree(page, 0, MEM_RELEASE);
+#else
+  munmap(page, 0x1000);
+#endif
+}
+
+TEST(address_unittest, test_address_read_available) {
+  const size_t page_size = mnemosyne::platform::page_size();
+#ifdef _WIN32
+  auto pages = static_cast<uint8_t*>(VirtualAlloc(
+      nullptr, 3 * page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+  auto pages = static_cast<uint8_t*>(
+      mmap(nullptr, 3 * page_size, PROT_READ | PROT_WRITE,
+           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+
+  memset(pages, 0xcc, 3 * page_size);
+  EXPECT_TRUE(mnemosyne::platform::protect(pages + page_size, page_size,
+                                           false, false, false));
+
+  // starts and ends part way into the readable pages around the hole
+  std::vector<uint8_t> buffer(3 * page_size - 32, 0xff);
+  mnemosyne::partial_read result = mnemosyne::address(pages + 16)
+                                       .read_available(buffer.data(),
+                                                       buffer.size());
+
+  EXPECT_EQ(buffer.size() - page_size, result.bytes);
+  EXPECT_EQ(std::vector<bool>({true, false, true}), result.pages);
+  EXPECT_EQ(0xcc, buffer.at(0));
+  EXPECT_EQ(0xcc, buffer.at(page_size - 17));
+  EXPECT_EQ(0x00, buffer.at(page_size - 16));
+  EXPECT_EQ(0x00, buffer.at(2 * page_size - 17));
+  EXPECT_EQ(0xcc, buffer.at(2 * page_size - 16));
+  EXPECT_EQ(0xcc, buffer.back());
+
+  result = mnemosyne::address(0x10).read_available(buffer.data(), 4);
+  EXPECT_EQ(0, result.bytes);
+  EXPECT_EQ(std::vector<bool>({false}), result.pages);
+
+#ifdef _WIN32
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  munmap(pages, 3 * page_size);
+#endif
+}
+
+TEST(address_unittest, test_address_ptr_val_invalid_pointer) {
+  uintptr_t invalid = 0x10;
+
+  EXPECT_EQ(0, mnemosyne::address(&invalid).read_ptr_val<uint32_t>(0));
+  EXPECT_FALSE(mnemosyne::address(&invalid).write_ptr_val<uint32_t>(0, 1));
+}
+
 TEST(address_unittest, test_address_write_ptr_val) {
   struct test_struct {
     uint8_t a;
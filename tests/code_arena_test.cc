@@ -0,0 +1,79 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+int32_t near_function() {
+  return 7;
+}
+
+uintptr_t distance(uintptr_t a, uintptr_t b) {
+  return a > b ? a - b : b - a;
+}
+}  // namespace
+
+TEST(code_arena_unittest, test_code_arena_slots) {
+  mnemosyne::code_arena arena;
+  const auto target = reinterpret_cast<uintptr_t>(&near_function);
+
+  uintptr_t first = arena.allocate(target, 20);
+  uintptr_t second = arena.allocate(target, 1);
+  ASSERT_NE(0, first);
+  ASSERT_NE(0, second);
+
+  EXPECT_EQ(0, first % 16);
+  EXPECT_EQ(first + 32, second);
+  EXPECT_LT(distance(first, target), uintptr_t(0x80000000));
+  EXPECT_EQ(48, arena.used());
+  EXPECT_EQ(0x10000, arena.reserved());
+
+  // released slots are handed out again, joined with their neighbours
+  arena.release(first);
+  EXPECT_EQ(first, arena.allocate(target, 16));
+  arena.release(second);
+  arena.release(first);
+  EXPECT_EQ(0, arena.used());
+  EXPECT_EQ(first, arena.allocate(target, 48));
+
+  EXPECT_FALSE(arena.write(first, std::vector<uint8_t>(64).data(), 64));
+  EXPECT_FALSE(arena.write(first + 16, "", 1));
+
+  // a slot larger than a slab gets its own
+  EXPECT_NE(0, arena.allocate(target, 0x10001));
+  EXPECT_EQ(0x30000, arena.reserved());
+
+  arena.release_all();
+  EXPECT_EQ(0, arena.used());
+  EXPECT_EQ(0, arena.reserved());
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+TEST(code_arena_unittest, test_code_cave) {
+  // mov eax, 42; ret
+  const std::vector<uint8_t> code = {0xb8, 0x2a, 0x00, 0x00, 0x00, 0xc3};
+
+  const auto target = reinterpret_cast<uintptr_t>(&near_function);
+
+  uintptr_t cave = mnemosyne::address(target).code_cave(code);
+  ASSERT_NE(0, cave);
+  EXPECT_LT(distance(cave, target), uintptr_t(0x80000000));
+  EXPECT_EQ(42, reinterpret_cast<int32_t (*)()>(cave)());
+
+  // executable but not writable once written
+  mnemosyne::memory_region region = {0, 0, false, false, false};
+  EXPECT_TRUE(mnemosyne::platform::query(cave, region));
+  EXPECT_TRUE(region.executable);
+  EXPECT_FALSE(region.writable);
+
+  mnemosyne::code_arena::shared().release(cave);
+  EXPECT_EQ(0, mnemosyne::address(target).code_cave({}));
+}
+#endif
@@ -0,0 +1,107 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+uint8_t* allocate_pages(size_t size) {
+#ifdef _WIN32
+  return static_cast<uint8_t*>(
+      VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+  return static_cast<uint8_t*>(mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+}
+
+void free_pages(uint8_t* pages, size_t size) {
+#ifdef _WIN32
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  munmap(pages, size);
+#endif
+}
+
+std::vector<std::pair<uintptr_t, size_t>> pairs(
+    const std::vector<mnemosyne::snapshot::range>& ranges) {
+  std::vector<std::pair<uintptr_t, size_t>> result;
+  for (const auto& r : ranges) {
+    result.emplace_back(r.start, r.size);
+  }
+
+  return result;
+}
+
+uintptr_t at(const uint8_t* pages, size_t offset) {
+  return reinterpret_cast<uintptr_t>(pages + offset);
+}
+}  // namespace
+
+TEST(dirty_pages_unittest, test_dirty_pages_hashed) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  uint8_t* pages = allocate_pages(4 * page_size);
+  memset(pages, 0x11, 4 * page_size);
+
+  mnemosyne::dirty_pages dirty(at(pages, 0), 4 * page_size, false);
+  EXPECT_FALSE(dirty.soft_dirty());
+
+  using pair = std::pair<uintptr_t, size_t>;
+  EXPECT_EQ(std::vector<pair>({{at(pages, 0), 4 * page_size}}),
+            pairs(dirty.collect()));
+  EXPECT_TRUE(dirty.collect().empty());
+
+  pages[page_size + 5] = 0x22;
+  pages[3 * page_size] = 0x33;
+  // the same bytes written again are not a change
+  pages[2 * page_size] = 0x11;
+
+  EXPECT_EQ(std::vector<pair>(
+                {{at(pages, page_size), page_size},
+                 {at(pages, 3 * page_size), page_size}}),
+            pairs(dirty.collect()));
+  EXPECT_TRUE(dirty.collect().empty());
+
+  // a page that can no longer be read counts as dirty once
+  EXPECT_TRUE(mnemosyne::platform::protect(pages + 2 * page_size, page_size,
+                                           false, false, false));
+  EXPECT_EQ(std::vector<pair>({{at(pages, 2 * page_size), page_size}}),
+            pairs(dirty.collect()));
+  EXPECT_TRUE(dirty.collect().empty());
+
+  EXPECT_TRUE(mnemosyne::platform::protect(pages + 2 * page_size, page_size,
+                                           true, true, false));
+  EXPECT_EQ(std::vector<pair>({{at(pages, 2 * page_size), page_size}}),
+            pairs(dirty.collect()));
+
+  free_pages(pages, 4 * page_size);
+}
+
+TEST(dirty_pages_unittest, test_dirty_pages_written) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  uint8_t* pages = allocate_pages(4 * page_size);
+  memset(pages, 0x11, 4 * page_size);
+
+  // soft dirty bits where the kernel keeps them, hashes otherwise
+  mnemosyne::dirty_pages dirty(at(pages, 0), 4 * page_size);
+  EXPECT_EQ(1, dirty.collect().size());
+
+  pages[2 * page_size + 100] = 0x44;
+
+  auto ranges = dirty.collect();
+  ASSERT_EQ(1, ranges.size());
+  EXPECT_EQ(at(pages, 2 * page_size), ranges.front().start);
+  EXPECT_EQ(page_size, ranges.front().size);
+
+  free_pages(pages, 4 * page_size);
+}
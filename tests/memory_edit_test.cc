@@ -2,6 +2,17 @@
 
 #include <gtest/gtest.h>
 
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#if defined(__linux__) && defined(__x86_64__)
+#include <sys/mman.h>
+
+#include <atomic>
+#include <thread>
+#endif
+
 #ifdef _WIN64
 #pragma comment(lib, "mnemosyne.lib")
 #pragma comment(lib, "detours64.lib")
@@ -62,6 +73,7 @@ TEST(memory_edit_unittest, test_memory_data_edit_revert) {
   EXPECT_EQ(0xdeadbeef, n);
 }
 
+#ifdef _WIN32
 TEST(memory_edit_unittest, test_memory_redirect_edit) {
   static bool variable = false;
 
@@ -86,3 +98,238 @@ TEST(memory_edit_unittest, test_memory_redirect_edit) {
   redirect.revert();
   // MessageBoxA(0, "detour test ok", "", MB_OK);
 }
+
+TEST(memory_edit_unittest, test_redirect_batch) {
+  static int32_t calls = 0;
+
+  typedef decltype(&MessageBoxA) messageboxa_t;
+  typedef decltype(&MessageBoxW) messageboxw_t;
+  static messageboxa_t messageboxa = &MessageBoxA;
+  static messageboxw_t messageboxw = &MessageBoxW;
+
+  auto to_a = [](HWND, LPCSTR, LPCSTR, UINT) -> int {
+    ++calls;
+    return TRUE;
+  };
+  auto to_w = [](HWND, LPCWSTR, LPCWSTR, UINT) -> int {
+    ++calls;
+    return TRUE;
+  };
+
+  mnemosyne::redirect_batch batch;
+  EXPECT_EQ(0, batch.add(mnemosyne::memory_redirect::from<messageboxa_t>(
+                   &messageboxa, to_a)));
+  EXPECT_EQ(1, batch.add(mnemosyne::memory_redirect::from<messageboxw_t>(
+                   &messageboxw, to_w)));
+
+  ASSERT_TRUE(batch.attach());
+  MessageBoxA(0, "detour test failed", "", MB_OK);
+  MessageBoxW(0, L"detour test failed", L"", MB_OK);
+  EXPECT_EQ(2, calls);
+  EXPECT_TRUE(batch.detach());
+
+  // a redirect that can not attach leaves the others untouched
+  static messageboxa_t missing = nullptr;
+  messageboxa_t original = messageboxa;
+
+  batch.clear();
+  batch.add(mnemosyne::memory_redirect::from<messageboxa_t>(&messageboxa,
+                                                            to_a));
+  batch.add(mnemosyne::memory_redirect::from<messageboxa_t>(&missing, to_a));
+
+  EXPECT_FALSE(batch.attach());
+  EXPECT_EQ(original, messageboxa);
+}
+
+namespace {
+DWORD WINAPI fake_process_id() {
+  return 4242;
+}
+}  // namespace
+
+TEST(memory_edit_unittest, test_table_redirect) {
+  const DWORD process_id = GetCurrentProcessId();
+  mnemosyne::table_redirect redirect(
+      "kernel32.dll", "GetCurrentProcessId",
+      reinterpret_cast<void*>(&fake_process_id));
+
+  ASSERT_TRUE(redirect.edit());
+  EXPECT_LT(0, redirect.entries());
+  EXPECT_EQ(4242, GetCurrentProcessId());
+
+  auto original =
+      reinterpret_cast<decltype(&GetCurrentProcessId)>(redirect.original());
+  ASSERT_NE(nullptr, original);
+  EXPECT_EQ(process_id, original());
+
+  EXPECT_TRUE(redirect.revert());
+  EXPECT_EQ(process_id, GetCurrentProcessId());
+  EXPECT_FALSE(redirect.revert());
+}
+#endif
+
+#if defined(__linux__) && defined(__x86_64__)
+namespace {
+__attribute__((noinline)) int32_t scale(int32_t value) {
+  volatile int32_t factor = 3;
+  return value * factor;
+}
+
+typedef int32_t (*function_t)(int32_t);
+
+// called through a volatile pointer so the call is not folded away
+function_t volatile call_scale = &scale;
+function_t original_scale = &scale;
+
+int32_t hooked_scale(int32_t value) {
+  return original_scale(value) + 1000;
+}
+
+// code written by hand for what the relocation has to fix up
+const uint8_t rip_relative[] = {
+    0x8b, 0x05, 0xfa, 0x00, 0x00, 0x00,  // mov eax, [rip + 0xfa]
+    0xc3,                                // ret
+};
+const uint8_t short_branch[] = {
+    0x85, 0xff,                          // test edi, edi
+    0x74, 0x06,                          // je +6
+    0xb8, 0x01, 0x00, 0x00, 0x00,        // mov eax, 1
+    0xc3,                                // ret
+    0xb8, 0x02, 0x00, 0x00, 0x00,        // mov eax, 2
+    0xc3,                                // ret
+};
+
+function_t original_rip_relative = nullptr;
+function_t original_short_branch = nullptr;
+
+int32_t hooked_rip_relative(int32_t value) {
+  return original_rip_relative(value) + 100;
+}
+
+int32_t hooked_short_branch(int32_t value) {
+  return original_short_branch(value) + 100;
+}
+}  // namespace
+
+TEST(memory_edit_unittest, test_memory_redirect_inline_hook) {
+  auto redirect = mnemosyne::memory_redirect::from<function_t>(
+      &original_scale, &hooked_scale);
+
+  EXPECT_EQ(21, call_scale(7));
+  ASSERT_TRUE(redirect.edit());
+  EXPECT_NE(&scale, original_scale);
+  EXPECT_EQ(1021, call_scale(7));
+  EXPECT_EQ(21, original_scale(7));
+
+  EXPECT_TRUE(redirect.revert());
+  EXPECT_EQ(&scale, original_scale);
+  EXPECT_EQ(21, call_scale(7));
+
+  EXPECT_FALSE(redirect.revert());
+}
+
+TEST(memory_edit_unittest, test_memory_redirect_relocation) {
+  auto page = static_cast<uint8_t*>(mmap(nullptr, 0x1000,
+                                         PROT_READ | PROT_WRITE,
+                                         MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  memcpy(page, rip_relative, sizeof(rip_relative));
+  memcpy(page + 0x40, short_branch, sizeof(short_branch));
+  // read by the mov, 0xfa past its end
+  const int32_t value = 41;
+  memcpy(page + 0x100, &value, sizeof(value));
+  mprotect(page, 0x1000, PROT_READ | PROT_EXEC);
+
+  auto read_value = reinterpret_cast<function_t>(page);
+  auto is_zero = reinterpret_cast<function_t>(page + 0x40);
+  original_rip_relative = read_value;
+  original_short_branch = is_zero;
+
+  mnemosyne::redirect_batch batch;
+  batch.add(mnemosyne::memory_redirect::from<function_t>(
+      &original_rip_relative, &hooked_rip_relative));
+  batch.add(mnemosyne::memory_redirect::from<function_t>(
+      &original_short_branch, &hooked_short_branch));
+
+  ASSERT_TRUE(batch.attach());
+  EXPECT_EQ(141, read_value(0));
+  EXPECT_EQ(102, is_zero(0));
+  EXPECT_EQ(101, is_zero(5));
+
+  EXPECT_TRUE(batch.detach());
+  EXPECT_EQ(41, read_value(0));
+  EXPECT_EQ(2, is_zero(0));
+  EXPECT_EQ(read_value, original_rip_relative);
+
+  // a redirect that can not attach undoes the ones before it
+  function_t missing = nullptr;
+  batch.add(mnemosyne::memory_redirect::from<function_t>(&missing,
+                                                         &hooked_scale));
+  EXPECT_FALSE(batch.attach());
+  EXPECT_EQ(read_value, original_rip_relative);
+  EXPECT_EQ(is_zero, original_short_branch);
+  EXPECT_EQ(41, read_value(0));
+
+  munmap(page, 0x1000);
+}
+
+TEST(memory_edit_unittest, test_memory_redirect_running_threads) {
+  auto redirect = mnemosyne::memory_redirect::from<function_t>(
+      &original_scale, &hooked_scale);
+
+  std::atomic<bool> done(false);
+  std::atomic<size_t> unexpected(0);
+  std::thread caller([&]() {
+    while (!done) {
+      int32_t result = call_scale(7);
+      if (result != 21 && result != 1021) {
+        ++unexpected;
+      }
+    }
+  });
+
+  for (size_t n = 0; n < 100; ++n) {
+    ASSERT_TRUE(redirect.edit());
+    ASSERT_TRUE(redirect.revert());
+  }
+
+  done = true;
+  caller.join();
+  EXPECT_EQ(0, unexpected);
+}
+#endif
+
+#ifdef __linux__
+namespace {
+pid_t fake_parent_id() {
+  return 4242;
+}
+}  // namespace
+
+TEST(memory_edit_unittest, test_table_redirect) {
+  const pid_t parent_id = getppid();
+  mnemosyne::table_redirect redirect(
+      "", "getppid", reinterpret_cast<void*>(&fake_parent_id));
+
+  ASSERT_TRUE(redirect.edit());
+  EXPECT_LT(0, redirect.entries());
+  EXPECT_EQ(4242, getppid());
+
+  // a second edit would lose the original entries
+  EXPECT_FALSE(redirect.edit());
+
+  auto original = reinterpret_cast<pid_t (*)()>(redirect.original());
+  ASSERT_NE(nullptr, original);
+  EXPECT_EQ(parent_id, original());
+
+  EXPECT_TRUE(redirect.revert());
+  EXPECT_EQ(parent_id, getppid());
+  EXPECT_FALSE(redirect.revert());
+
+  // only the named library is asked for the original
+  mnemosyne::table_redirect named(
+      "libc.so.6", "getppid", reinterpret_cast<void*>(&fake_parent_id));
+  ASSERT_TRUE(named.edit());
+  EXPECT_EQ(original, named.original());
+  EXPECT_TRUE(named.revert());
+}
+#endif
@@ -0,0 +1,152 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+uint32_t current_pid() {
+#ifdef _WIN32
+  return GetCurrentProcessId();
+#else
+  return static_cast<uint32_t>(getpid());
+#endif
+}
+}  // namespace
+
+TEST(memory_source_unittest, test_local_source) {
+  uint32_t n = 0xdeadbeef;
+  mnemosyne::local_source& source = mnemosyne::local_source::instance();
+  mnemosyne::address ptr(source, reinterpret_cast<uintptr_t>(&n));
+
+  EXPECT_TRUE(source.in_process());
+  EXPECT_EQ(0xdeadbeef, ptr.read<uint32_t>());
+  EXPECT_TRUE(ptr.write<uint32_t>(0x12345678));
+  EXPECT_EQ(0x12345678, n);
+
+  uint32_t value = 0;
+  EXPECT_FALSE(source.read(&value, 0x10, sizeof(value)));
+}
+
+TEST(memory_source_unittest, test_remote_source_self) {
+  uint64_t values[3] = {0x1111, 0x2222, 0x3333};
+  uint64_t copies[3] = {0, 0, 0};
+
+  mnemosyne::remote_source source(current_pid());
+  ASSERT_TRUE(source.attached());
+  EXPECT_FALSE(source.in_process());
+
+  std::vector<mnemosyne::memory_source::request> requests;
+  for (size_t n = 0; n < 3; ++n) {
+    requests.push_back({reinterpret_cast<uintptr_t>(&values[n]), &copies[n],
+                        sizeof(uint64_t)});
+  }
+
+  // a failing request in the middle does not fail the ones after it
+  requests.insert(requests.begin() + 1, {0x10, &copies[0], sizeof(uint64_t)});
+
+  std::vector<bool> expected = {true, false, true, true};
+  EXPECT_EQ(expected, source.read_many(requests));
+  EXPECT_EQ(0x1111, copies[0]);
+  EXPECT_EQ(0x2222, copies[1]);
+  EXPECT_EQ(0x3333, copies[2]);
+
+  // the same reads into a batch kept across calls
+  mnemosyne::memory_source::batch batch;
+  source.read_many(requests, batch);
+  EXPECT_EQ(expected, batch.results);
+
+#ifndef _WIN32
+  const iovec* local = batch.local.data();
+  source.read_many(requests, batch);
+  EXPECT_EQ(expected, batch.results);
+  // no new buffers the second time
+  EXPECT_EQ(local, batch.local.data());
+#endif
+}
+
+#ifndef _WIN32
+TEST(memory_source_unittest, test_remote_source_child_process) {
+  const size_t page_size = mnemosyne::platform::page_size();
+
+  struct node {
+    uint32_t value;
+    node* next;
+  };
+
+  node last = {0x5678, nullptr};
+  node first = {0x1234, &last};
+  node* head = &first;
+
+  std::vector<uint8_t> haystack(0x10000, 0);
+  const uint8_t needle[] = {0xde, 0xad, 0xbe, 0xef, 0x90, 0xcc};
+  std::copy(needle, needle + sizeof(needle), haystack.begin() + 0x4321);
+
+  auto read_only = static_cast<uint8_t*>(mmap(nullptr, page_size, PROT_READ,
+                                              MAP_PRIVATE | MAP_ANONYMOUS,
+                                              -1, 0));
+
+  pid_t child = fork();
+  ASSERT_NE(-1, child);
+  if (!child) {
+    for (;;) {
+      pause();
+    }
+  }
+
+  // the parent's copies no longer hold what the child sees
+  std::fill(haystack.begin(), haystack.end(), 0);
+  first.value = 0;
+
+  mnemosyne::remote_source source(static_cast<uint32_t>(child));
+  ASSERT_TRUE(source.attached());
+
+  mnemosyne::address remote_head(source, reinterpret_cast<uintptr_t>(&head));
+  EXPECT_EQ(0x1234, remote_head.read_ptr_val<uint32_t>(offsetof(node, value)));
+  EXPECT_EQ(0x5678, remote_head.read_multilevel_ptr_val<uint32_t>(
+                        std::queue<size_t>({offsetof(node, next), 0})));
+
+  EXPECT_TRUE(remote_head.write_ptr_val<uint32_t>(offsetof(node, value), 1));
+  EXPECT_EQ(1, remote_head.read_ptr_val<uint32_t>(offsetof(node, value)));
+  EXPECT_EQ(0, first.value);
+
+  // the child's page is read only, the write goes through regardless
+  mnemosyne::address remote_page(source,
+                                 reinterpret_cast<uintptr_t>(read_only));
+  EXPECT_TRUE(remote_page.write<uint32_t>(0xdeadbeef));
+  EXPECT_EQ(0xdeadbeef, remote_page.read<uint32_t>());
+  EXPECT_EQ(0, *reinterpret_cast<uint32_t*>(read_only));
+
+  mnemosyne::pattern_match remote_match(
+      "DE AD BE EF ?? CC", source,
+      reinterpret_cast<uintptr_t>(haystack.data()), haystack.size());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(haystack.data()) + 0x4321,
+            remote_match.find_address());
+  EXPECT_EQ(0, remote_match.find_next_address());
+
+  std::vector<uintptr_t> expected = {
+      reinterpret_cast<uintptr_t>(haystack.data()) + 0x4321};
+  EXPECT_EQ(expected, remote_match.find_all());
+
+  mnemosyne::pattern_match local_match("DE AD BE EF ?? CC", haystack.data(),
+                                       haystack.size());
+  EXPECT_EQ(0, local_match.find_address());
+
+  kill(child, SIGKILL);
+  waitpid(child, nullptr, 0);
+  munmap(read_only, page_size);
+}
+#endif
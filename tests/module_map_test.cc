@@ -0,0 +1,120 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <dlfcn.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+int32_t in_text(int32_t value) {
+  return value * 3;
+}
+
+int32_t in_data = 7;
+
+bool contains(const mnemosyne::memory_region& range, uintptr_t address) {
+  return range.start <= address && address < range.start + range.size;
+}
+
+#ifdef _WIN32
+const char* library = "kernel32.dll";
+const char* function = "GetCurrentProcessId";
+
+uintptr_t resolve(const char* name) {
+  return reinterpret_cast<uintptr_t>(
+      GetProcAddress(GetModuleHandleA(library), name));
+}
+#else
+const char* library = "libc.so.6";
+const char* function = "getppid";
+
+uintptr_t resolve(const char* name) {
+  return reinterpret_cast<uintptr_t>(dlsym(RTLD_DEFAULT, name));
+}
+#endif
+}  // namespace
+
+TEST(module_map_unittest, test_module_map_sections) {
+  mnemosyne::module_map map;
+
+  auto modules = map.modules();
+  ASSERT_FALSE(modules.empty());
+  EXPECT_EQ("", modules.front().name);
+
+  const auto text = map.section("", ".text");
+  EXPECT_TRUE(contains(text, reinterpret_cast<uintptr_t>(&in_text)));
+  EXPECT_TRUE(text.executable);
+  EXPECT_FALSE(text.writable);
+
+  const auto data = map.section("", ".data");
+  EXPECT_TRUE(contains(data, reinterpret_cast<uintptr_t>(&in_data)));
+  EXPECT_TRUE(data.writable);
+
+  // every section lies within its module
+  const auto range = mnemosyne::regions::module_range("");
+  for (const auto& s : map.sections("")) {
+    EXPECT_FALSE(s.name.empty());
+    EXPECT_LE(range.start, s.range.start);
+    EXPECT_GE(range.start + range.size, s.range.start + s.range.size);
+  }
+
+  EXPECT_EQ(0, map.section("", ".missing").size);
+  EXPECT_EQ(0, map.section("not_loaded_module", ".text").size);
+  EXPECT_TRUE(map.sections("not_loaded_module").empty());
+}
+
+TEST(module_map_unittest, test_module_map_symbols) {
+  mnemosyne::module_map map;
+
+  const uintptr_t address = map.symbol(library, function);
+  ASSERT_NE(0, address);
+  EXPECT_EQ(resolve(function), address);
+  EXPECT_EQ(address, map.symbol(library, function));
+
+#ifndef _WIN32
+  // indirect functions resolve to the implementation the loader picked
+  EXPECT_EQ(resolve("memcpy"), map.symbol(library, "memcpy"));
+#endif
+
+  EXPECT_EQ(0, map.symbol(library, "not_an_exported_symbol"));
+  EXPECT_EQ(0, map.symbol("not_loaded_module", function));
+}
+
+TEST(module_map_unittest, test_pattern_match_in_section) {
+  const auto start = reinterpret_cast<const uint8_t*>(&in_text);
+  const std::string pattern = mnemosyne::util::byte_to_string(
+      std::vector<uint8_t>(start, start + 8));
+
+  auto match = mnemosyne::pattern_match::in_section(pattern, "", ".text");
+  EXPECT_NE(0, match.find_address());
+
+  EXPECT_EQ(0, mnemosyne::pattern_match::in_section(pattern, "", ".missing")
+                   .find_address());
+}
+
+#ifndef _WIN32
+TEST(module_map_unittest, test_module_map_follows_loads) {
+  mnemosyne::module_map map;
+  if (map.section("libresolv.so.2", ".text").size) {
+    GTEST_SKIP() << "libresolv.so.2 is loaded already";
+  }
+
+  void* handle = dlopen("libresolv.so.2", RTLD_NOW);
+  if (!handle) {
+    GTEST_SKIP() << "libresolv.so.2 is not installed";
+  }
+
+  // no invalidate(), the load is noticed by itself
+  EXPECT_NE(0, map.section("libresolv.so.2", ".text").size);
+  dlclose(handle);
+}
+#endif
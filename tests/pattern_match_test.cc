@@ -10,6 +10,22 @@
 #pragma comment(lib, "detours.lib")
 #endif
 
+namespace {
+// both parsers read text the same, or both reject it
+template <size_t N>
+void expect_same_parse(const char (&text)[N],
+                       const std::vector<uint8_t>& haystack) {
+  const mnemosyne::compiled_pattern<N> compiled(text);
+  auto data = const_cast<uint8_t*>(haystack.data());
+
+  EXPECT_EQ(mnemosyne::pattern_match(text, data, haystack.size())
+                .find_address(),
+            compiled.size() ? compiled.find_address(data, haystack.size())
+                            : 0)
+      << text;
+}
+}  // namespace
+
 TEST(pattern_match_unittest, test_pattern_match_find_address) {
   std::vector<uint8_t> haystack = {
       0xf1, 0x80, 0xd7, 0x50, 0x1a, 0x7b, 0x69, 0x57, 0x07, 0x80, 0xbc,
@@ -41,3 +57,193 @@ TEST(pattern_match_unittest, test_pattern_match_find_next_address) {
   EXPECT_EQ(reinterpret_cast<uintptr_t>(haystack.data()) + 32,
             match.find_next_address());
 }
+
+TEST(pattern_match_unittest, test_pattern_match_find_address_at_end) {
+  std::vector<uint8_t> haystack(100, 0x90);
+  haystack.at(97) = 0xab;
+  haystack.at(99) = 0xcd;
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(haystack.data()) + 97,
+            mnemosyne::pattern_match("ab ?? cd", haystack.data(),
+                                     haystack.size())
+                .find_address());
+  EXPECT_EQ(0, mnemosyne::pattern_match("ab ?? cd", haystack.data(),
+                                        haystack.size() - 1)
+                   .find_address());
+}
+
+TEST(pattern_match_unittest, test_pattern_match_scan_engines) {
+  std::mt19937 mt(1234);
+  std::uniform_int_distribution<int32_t> dist(0, 3);
+
+  // small alphabet so that anchors hit often and verification is exercised
+  std::vector<uint8_t> haystack(4096);
+  for (auto& byte : haystack) {
+    byte = static_cast<uint8_t>(0xa0 + dist(mt));
+  }
+
+  const std::string patterns[] = {"a1 a2",
+                                  "a0 ?? a3",
+                                  "a3 a3 ?? ?? a1 a0 a2",
+                                  "?? a1 a0 a0 ?? a2 a3 a1 a0 ?? ?? a2 a1 a3 "
+                                  "a2 a0 a1 ?? a3 a0 a0 a1 a2 ?? a3 a1 a0 a2 "
+                                  "a1 a3 a0 a2 a1 a0 a3"};
+
+  for (const auto& pattern : patterns) {
+    std::vector<uintptr_t> expected;
+    mnemosyne::pattern_match reference(pattern, haystack.data(),
+                                       haystack.size());
+    reference.use_engine(mnemosyne::pattern_match::scan_engine::scalar);
+    for (uintptr_t address = reference.find_address(); address;
+         address = reference.find_next_address()) {
+      expected.push_back(address);
+    }
+
+    for (auto engine : {mnemosyne::pattern_match::scan_engine::sse2,
+                        mnemosyne::pattern_match::scan_engine::avx2}) {
+      std::vector<uintptr_t> actual;
+      mnemosyne::pattern_match match(pattern, haystack.data(),
+                                     haystack.size());
+      match.use_engine(engine);
+      for (uintptr_t address = match.find_address(); address;
+           address = match.find_next_address()) {
+        actual.push_back(address);
+      }
+
+      EXPECT_EQ(expected, actual);
+    }
+  }
+}
+
+TEST(pattern_match_unittest, test_pattern_match_trailing_wildcard_view) {
+  // 00 is as common as the placeholder byte of the ??, the anchor has to
+  // be the literal anyway
+  const uint8_t bytes[] = {0x00, 0x00};
+  const uint8_t mask[] = {0xff, 0x00};
+  const uint8_t wildcards[] = {0x00, 0x00};
+  std::vector<uint8_t> haystack(64, 0x90);
+  haystack[40] = 0x00;
+
+  for (auto engine : {mnemosyne::pattern_match::scan_engine::scalar,
+                      mnemosyne::pattern_match::scan_engine::sse2,
+                      mnemosyne::pattern_match::scan_engine::avx2}) {
+    mnemosyne::pattern_match match({bytes, mask, 2}, haystack.data(),
+                                   haystack.size());
+    match.use_engine(engine);
+    EXPECT_EQ(reinterpret_cast<uintptr_t>(haystack.data()) + 40,
+              match.find_address());
+
+    // nothing to anchor on, it never matches
+    mnemosyne::pattern_match none({bytes, wildcards, 2}, haystack.data(),
+                                  haystack.size());
+    none.use_engine(engine);
+    EXPECT_EQ(0, none.find_address());
+  }
+}
+
+TEST(pattern_match_unittest, test_pattern_match_find_address_parallel) {
+  // spans several scan chunks, with matches straddling chunk boundaries
+  std::vector<uint8_t> haystack(3 * 1024 * 1024 + 123, 0x90);
+  const std::vector<uint8_t> needle = {0xde, 0xad, 0x00, 0xbe, 0xef};
+  const size_t offsets[] = {1024 * 1024 - 2, 2 * 1024 * 1024 - 1,
+                            2 * 1024 * 1024 + 7, haystack.size() - 5};
+
+  for (size_t offset : offsets) {
+    std::copy(needle.begin(), needle.end(), haystack.begin() + offset);
+  }
+
+  uintptr_t base = reinterpret_cast<uintptr_t>(haystack.data());
+  mnemosyne::pattern_match match("de ad ?? be ef", haystack.data(),
+                                 haystack.size());
+
+  EXPECT_EQ(base + offsets[0], match.find_address_parallel(4));
+  EXPECT_EQ(base + offsets[1], match.find_next_address());
+
+  std::vector<uintptr_t> expected;
+  for (size_t offset : offsets) {
+    expected.push_back(base + offset);
+  }
+  EXPECT_EQ(expected, match.find_all(4));
+  EXPECT_EQ(expected, match.find_all(1));
+
+  EXPECT_EQ(0, mnemosyne::pattern_match("de ad ?? be ef 11", haystack.data(),
+                                        haystack.size())
+                   .find_address_parallel());
+}
+
+TEST(pattern_match_unittest, test_pattern_match_rescan) {
+  std::vector<uint8_t> haystack(0x40000, 0x90);
+  const std::vector<uint8_t> needle = {0xde, 0xad, 0x00, 0xbe, 0xef};
+
+  for (size_t offset : {0x100, 0x10ffe, 0x20000, 0x3f000}) {
+    std::copy(needle.begin(), needle.end(), haystack.begin() + offset);
+  }
+
+  uintptr_t base = reinterpret_cast<uintptr_t>(haystack.data());
+  mnemosyne::pattern_match match("de ad ?? be ef", haystack.data(),
+                                 haystack.size());
+  mnemosyne::dirty_pages dirty(base, haystack.size(), false);
+
+  std::vector<uintptr_t> previous = match.find_all();
+  dirty.collect();
+
+  // one match destroyed, one across a page boundary and one added
+  haystack.at(0x20001) = 0x00;
+  std::copy(needle.begin(), needle.end(), haystack.begin() + 0x2fffe);
+  std::copy(needle.begin(), needle.end(), haystack.begin() + 0x30800);
+
+  std::vector<uintptr_t> found = match.rescan(previous, dirty.collect(), 2);
+  EXPECT_EQ(match.find_all(), found);
+  EXPECT_EQ(5, found.size());
+
+  EXPECT_EQ(found, match.rescan(found, dirty.collect()));
+}
+
+TEST(pattern_match_unittest, test_compiled_pattern) {
+  static constexpr mnemosyne::compiled_pattern pattern(
+      "7b ?? 57 07 ?? bc ?? c7 ?? ??");
+
+  static_assert(pattern.size() == 8, "trailing ?? are removed");
+  static_assert(pattern.byte_at(0) == 0x7b, "");
+  static_assert(pattern.is_wildcard(1), "");
+  static_assert(pattern.byte_at(5) == 0xbc, "");
+  static_assert(!pattern.is_wildcard(7), "");
+  static_assert(mnemosyne::compiled_pattern("7b 5").size() == 0, "");
+  static_assert(mnemosyne::compiled_pattern("7b zz").size() == 0, "");
+
+  std::vector<uint8_t> first = {0x90, 0x7b, 0x69, 0x57, 0x07, 0x80,
+                                0xbc, 0x27, 0xc7, 0x90, 0x90};
+  std::vector<uint8_t> second = {0x90, 0x90, 0x90, 0x90, 0x7b, 0x00,
+                                 0x57, 0x07, 0x00, 0xbc, 0x00, 0xc7};
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first.data()) + 1,
+            pattern.find_address(first.data(), first.size()));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(second.data()) + 4,
+            pattern.find_address(second.data(), second.size()));
+  EXPECT_EQ(1, pattern.find_all(second.data(), second.size()).size());
+
+  mnemosyne::pattern_match match(pattern.view(), first.data(), first.size());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(first.data()) + 1,
+            match.find_address());
+  EXPECT_EQ(0, match.find_next_address());
+}
+
+TEST(pattern_match_unittest, test_compiled_pattern_syntax) {
+  // whitespaces may split a byte, trailing ? and whitespaces are trimmed
+  static_assert(mnemosyne::compiled_pattern("7 b5 7").size() == 2, "");
+  static_assert(mnemosyne::compiled_pattern("7b 57 ?").size() == 2, "");
+  static_assert(mnemosyne::compiled_pattern("7b ?? ??  ").size() == 1, "");
+  static_assert(mnemosyne::compiled_pattern("").size() == 0, "");
+  static_assert(mnemosyne::compiled_pattern("? 7b").size() == 0, "");
+
+  const std::vector<uint8_t> haystack = {0x90, 0x7b, 0x57, 0x07, 0x90};
+  expect_same_parse("7b 57 07", haystack);
+  expect_same_parse("7 b5 70 7", haystack);
+  expect_same_parse("7b57 07", haystack);
+  expect_same_parse("7b ?? 07 ?", haystack);
+  expect_same_parse("7b ?? ?? ", haystack);
+  expect_same_parse("7b 5", haystack);
+  expect_same_parse("7b zz", haystack);
+  expect_same_parse("? 7b", haystack);
+  expect_same_parse("  ", haystack);
+}
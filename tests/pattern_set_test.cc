@@ -0,0 +1,107 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+TEST(pattern_set_unittest, test_pattern_set_find_all) {
+  std::vector<uint8_t> haystack = {
+      0xf1, 0x80, 0xd7, 0x50, 0x1a, 0x7b, 0x69, 0x57, 0x07, 0x80, 0xbc, 0x27,
+      0xc7, 0x5e, 0x88, 0x0c, 0xac, 0x7f, 0xd8, 0xe0, 0x13, 0x7d, 0xf4, 0xfb,
+      0xf4, 0x91, 0x0b, 0x07, 0xa6, 0xe1, 0x54, 0x22, 0x7b, 0xa0, 0x57, 0x07,
+      0x2b, 0xbc, 0xdd, 0xc7, 0x24, 0x53, 0xb3, 0x3f, 0xf1, 0xd5, 0x67, 0x23};
+  uintptr_t base = reinterpret_cast<uintptr_t>(haystack.data());
+
+  mnemosyne::pattern_set set({"7b ?? 57 07 ?? bc ?? c7", "f4 ?? 0b", "07",
+                              "67 23 11", "", "f1"},
+                             haystack.data(), haystack.size());
+  auto matches = set.find_all();
+
+  std::vector<std::pair<size_t, uintptr_t>> expected = {
+      {5, base + 0},  {0, base + 5},  {2, base + 8},  {1, base + 24},
+      {2, base + 27}, {0, base + 32}, {2, base + 35}, {5, base + 44}};
+
+  ASSERT_EQ(expected.size(), matches.size());
+  for (size_t n = 0; n < expected.size(); ++n) {
+    EXPECT_EQ(expected.at(n).first, matches.at(n).pattern);
+    EXPECT_EQ(expected.at(n).second, matches.at(n).address);
+  }
+}
+
+TEST(pattern_set_unittest, test_pattern_set_find_addresses) {
+  std::vector<uint8_t> haystack = {
+      0xf1, 0x80, 0xd7, 0x50, 0x1a, 0x7b, 0x69, 0x57, 0x07, 0x80, 0xbc, 0x27,
+      0xc7, 0x5e, 0x88, 0x0c, 0xac, 0x7f, 0xd8, 0xe0, 0x13, 0x7d, 0xf4, 0xfb,
+      0xf4, 0x91, 0x0b, 0x07, 0xa6, 0xe1, 0x54, 0x22, 0x7b, 0xa0, 0x57, 0x07};
+  uintptr_t base = reinterpret_cast<uintptr_t>(haystack.data());
+
+  const std::vector<std::string> patterns = {"7b ?? 57 07 ?? bc ?? c7",
+                                             "?? 07 ?? e1", "57 07", "aa bb"};
+  auto addresses =
+      mnemosyne::pattern_set(patterns, haystack.data(), haystack.size())
+          .find_addresses();
+
+  ASSERT_EQ(patterns.size(), addresses.size());
+  for (size_t n = 0; n < patterns.size(); ++n) {
+    EXPECT_EQ(mnemosyne::pattern_match(patterns.at(n), haystack.data(),
+                                       haystack.size())
+                  .find_address(),
+              addresses.at(n));
+  }
+
+  EXPECT_EQ(base + 5, addresses.at(0));
+  EXPECT_EQ(base + 26, addresses.at(1));
+  EXPECT_EQ(base + 7, addresses.at(2));
+  EXPECT_EQ(0, addresses.at(3));
+}
+
+TEST(pattern_set_unittest, test_pattern_set_skips_unreadable_pages) {
+  const size_t page_size = mnemosyne::platform::page_size();
+#ifdef _WIN32
+  auto pages = static_cast<uint8_t*>(VirtualAlloc(
+      nullptr, 3 * page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+  auto pages = static_cast<uint8_t*>(mmap(nullptr, 3 * page_size,
+                                          PROT_READ | PROT_WRITE,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+  memset(pages, 0x90, 3 * page_size);
+
+  const uint8_t needle[] = {0xde, 0xad, 0xbe, 0xef};
+  memcpy(pages + 16, needle, sizeof(needle));
+  memcpy(pages + 2 * page_size + 16, needle, sizeof(needle));
+
+  // the matches lie on both sides of a page that can not be read
+  ASSERT_TRUE(mnemosyne::platform::protect(pages + page_size, page_size,
+                                           false, false, false));
+
+  auto matches = mnemosyne::pattern_set({"de ad be ef", "ad"}, pages,
+                                        3 * page_size)
+                     .find_all();
+
+  ASSERT_EQ(4, matches.size());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + 16), matches.at(0).address);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + 17), matches.at(1).address);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + 2 * page_size + 16),
+            matches.at(2).address);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + 2 * page_size + 17),
+            matches.at(3).address);
+
+#ifdef _WIN32
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  munmap(pages, 3 * page_size);
+#endif
+}
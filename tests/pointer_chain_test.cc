@@ -0,0 +1,93 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+struct inner {
+  uint64_t padding;
+  uint32_t value;
+};
+
+struct outer {
+  uint32_t padding;
+  inner* child;
+};
+}  // namespace
+
+TEST(pointer_chain_unittest, test_pointer_chain_resolve) {
+  inner first_inner = {0, 0x1234};
+  inner second_inner = {0, 0x5678};
+  outer obj = {0, &first_inner};
+  outer* root = &obj;
+
+  mnemosyne::pointer_chain chain(
+      reinterpret_cast<uintptr_t>(&root),
+      {offsetof(outer, child), offsetof(inner, value)});
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&first_inner.value), chain.resolve());
+  // same result as the queue based walk
+  EXPECT_EQ(0x1234,
+            mnemosyne::address(&root).read_multilevel_ptr_val<uint32_t>(
+                std::queue<size_t>(
+                    {offsetof(outer, child), offsetof(inner, value)})));
+
+  uint32_t value = 0;
+  EXPECT_TRUE(chain.read(value));
+  EXPECT_EQ(0x1234, value);
+
+  EXPECT_TRUE(chain.write<uint32_t>(0xbeef));
+  EXPECT_EQ(0xbeef, first_inner.value);
+
+  // a change below the base is seen after a refresh
+  obj.child = &second_inner;
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&first_inner.value), chain.resolve());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&second_inner.value), chain.refresh());
+  EXPECT_TRUE(chain.read(value));
+  EXPECT_EQ(0x5678, value);
+}
+
+TEST(pointer_chain_unittest, test_pointer_chain_root_change) {
+  inner a_inner = {0, 1};
+  inner b_inner = {0, 2};
+  outer a = {0, &a_inner};
+  outer b = {0, &b_inner};
+  outer* root = &a;
+
+  mnemosyne::pointer_chain chain(
+      reinterpret_cast<uintptr_t>(&root),
+      {offsetof(outer, child), offsetof(inner, value)});
+
+  uint32_t value = 0;
+  EXPECT_TRUE(chain.read(value));
+  EXPECT_EQ(1, value);
+
+  root = &b;
+  EXPECT_TRUE(chain.read(value));
+  EXPECT_EQ(2, value);
+}
+
+TEST(pointer_chain_unittest, test_pointer_chain_invalid) {
+  outer obj = {0, reinterpret_cast<inner*>(0x10)};
+  outer* root = &obj;
+
+  mnemosyne::pointer_chain chain(
+      reinterpret_cast<uintptr_t>(&root),
+      {offsetof(outer, child), offsetof(inner, padding), 0});
+
+  uint32_t value = 0;
+  EXPECT_EQ(0, chain.resolve());
+  EXPECT_FALSE(chain.read(value));
+  EXPECT_FALSE(chain.write<uint32_t>(1));
+
+  EXPECT_EQ(0, mnemosyne::pointer_chain(0x10, {0}).resolve());
+  EXPECT_EQ(0, mnemosyne::pointer_chain(
+                   reinterpret_cast<uintptr_t>(&root), {}).resolve());
+}
@@ -0,0 +1,84 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+struct player {
+  uint64_t id;
+  uint32_t health;
+};
+
+struct world {
+  uint8_t padding[0x40];
+  player* local_player;
+};
+
+world* global_world = nullptr;
+}  // namespace
+
+TEST(pointer_scan_unittest, test_regions_modules) {
+  std::vector<mnemosyne::loaded_module> modules = mnemosyne::regions::modules();
+
+  ASSERT_FALSE(modules.empty());
+  EXPECT_TRUE(modules.front().name.empty());
+  EXPECT_EQ(mnemosyne::regions::module_range("").start,
+            modules.front().range.start);
+
+  uintptr_t global = reinterpret_cast<uintptr_t>(&global_world);
+  EXPECT_LT(global - modules.front().range.start, modules.front().range.size);
+}
+
+TEST(pointer_scan_unittest, test_pointer_scan_find_paths) {
+  auto local_player = std::make_unique<player>(player{7, 100});
+  auto w = std::make_unique<world>();
+  w->local_player = local_player.get();
+  global_world = w.get();
+
+  uintptr_t target = reinterpret_cast<uintptr_t>(&local_player->health);
+  mnemosyne::pointer_scan scan;
+  EXPECT_LT(0, scan.size());
+
+  std::vector<mnemosyne::pointer_scan::path> paths =
+      scan.find_paths(target, 2, 0x100);
+
+  // global_world -> local_player -> health
+  auto expected = std::find_if(
+      paths.begin(), paths.end(),
+      [](const mnemosyne::pointer_scan::path& path) {
+        return path.module.empty() &&
+               mnemosyne::regions::module_range("").start + path.offset ==
+                   reinterpret_cast<uintptr_t>(&global_world);
+      });
+
+  ASSERT_NE(paths.end(), expected);
+  EXPECT_EQ(std::vector<size_t>({offsetof(world, local_player),
+                                 offsetof(player, health)}),
+            expected->offsets);
+
+  EXPECT_EQ(target, expected->chain().resolve());
+  for (const auto& path : paths) {
+    EXPECT_LE(path.offsets.size(), 2);
+  }
+
+  // the chain follows the objects once they move
+  auto moved = std::make_unique<player>(player{8, 50});
+  w->local_player = moved.get();
+
+  uint32_t health = 0;
+  mnemosyne::pointer_chain chain = expected->chain();
+  EXPECT_TRUE(chain.read(health));
+  EXPECT_EQ(50, health);
+
+  EXPECT_TRUE(scan.find_paths(target, 0, 0x100).empty());
+  EXPECT_LE(scan.find_paths(target, 2, 0x100, 1).size(), 1);
+
+  global_world = nullptr;
+}
@@ -0,0 +1,176 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#include <thread>
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+#ifdef _MSC_VER
+#define NOINLINE __declspec(noinline)
+#else
+#define NOINLINE __attribute__((noinline))
+#endif
+
+namespace {
+NOINLINE int32_t square(int32_t value) {
+  volatile int32_t copy = value;
+  return copy * copy;
+}
+
+// recurses through call_depth, so every call goes through the hook
+NOINLINE int32_t depth(int32_t n);
+
+NOINLINE double blend(double a, double b, int32_t weight) {
+  volatile double w = weight;
+  return a * w + b;
+}
+
+NOINLINE int32_t leaf(int32_t value) {
+  volatile int32_t copy = value;
+  return copy + 1;
+}
+
+// called through volatile pointers so the calls are not folded away
+int32_t (*volatile call_square)(int32_t) = &square;
+int32_t (*volatile call_depth)(int32_t) = &depth;
+double (*volatile call_blend)(double, double, int32_t) = &blend;
+int32_t (*volatile call_leaf)(int32_t) = &leaf;
+
+// with optimizations on the call is a jump, leaf returns through the
+// return address of outer
+NOINLINE int32_t outer(int32_t value) {
+  return call_leaf(value * 2);
+}
+
+int32_t (*volatile call_outer)(int32_t) = &outer;
+
+int32_t depth(int32_t n) {
+  return n ? call_depth(n - 1) + 1 : 0;
+}
+
+uint64_t sum(const std::vector<uint64_t>& histogram) {
+  uint64_t total = 0;
+  for (uint64_t n : histogram) {
+    total += n;
+  }
+
+  return total;
+}
+}  // namespace
+
+TEST(probe_unittest, test_probe_buckets) {
+  for (uint64_t ticks = 0; ticks < 16; ++ticks) {
+    EXPECT_EQ(ticks, mnemosyne::probe::bucket_of(ticks));
+    EXPECT_EQ(ticks, mnemosyne::probe::bucket_start(ticks));
+  }
+
+  EXPECT_EQ(16, mnemosyne::probe::bucket_of(16));
+  EXPECT_EQ(16, mnemosyne::probe::bucket_of(17));
+  EXPECT_EQ(17, mnemosyne::probe::bucket_of(18));
+  EXPECT_EQ(23, mnemosyne::probe::bucket_of(31));
+  EXPECT_EQ(24, mnemosyne::probe::bucket_of(32));
+  EXPECT_EQ(mnemosyne::probe::bucket_count - 1,
+            mnemosyne::probe::bucket_of(UINT64_MAX));
+
+  // every bucket starts right after the previous one ends
+  for (size_t bucket = 1; bucket < mnemosyne::probe::bucket_count; ++bucket) {
+    const uint64_t start = mnemosyne::probe::bucket_start(bucket);
+    EXPECT_EQ(bucket, mnemosyne::probe::bucket_of(start));
+    EXPECT_EQ(bucket - 1, mnemosyne::probe::bucket_of(start - 1));
+  }
+
+  mnemosyne::probe::statistics statistics = {
+      0, 0, 0, std::vector<uint64_t>(mnemosyne::probe::bucket_count)};
+  EXPECT_EQ(0, statistics.percentile(0.5));
+
+  statistics.histogram[3] = 90;
+  statistics.histogram[16] = 10;
+  EXPECT_EQ(3, statistics.percentile(0.5));
+  EXPECT_EQ(3, statistics.percentile(0.9));
+  EXPECT_EQ(17, statistics.percentile(0.95));
+  EXPECT_EQ(3, statistics.percentile(0));
+}
+
+#if defined(__x86_64__) || defined(_M_X64)
+TEST(probe_unittest, test_probe_threads) {
+  const size_t calls = 10000;
+  mnemosyne::probe probe(reinterpret_cast<void*>(&square));
+
+  ASSERT_TRUE(probe.attach());
+  EXPECT_TRUE(probe.attached());
+
+  auto run = [&]() {
+    for (size_t n = 0; n < calls; ++n) {
+      EXPECT_EQ(49, call_square(7));
+    }
+  };
+
+  std::thread other(run);
+  run();
+  other.join();
+
+  mnemosyne::probe::statistics statistics = probe.collect();
+  EXPECT_EQ(2 * calls, statistics.calls);
+  EXPECT_EQ(2 * calls, statistics.timed);
+  EXPECT_EQ(statistics.timed, sum(statistics.histogram));
+  EXPECT_LE(statistics.percentile(0.5), statistics.percentile(0.99));
+  EXPECT_LT(0, probe.ticks_per_second());
+
+  // counts stop with the probe detached
+  EXPECT_TRUE(probe.detach());
+  EXPECT_FALSE(probe.attached());
+  EXPECT_EQ(49, call_square(7));
+  EXPECT_EQ(2 * calls, probe.collect().calls);
+}
+
+TEST(probe_unittest, test_probe_recursion) {
+  mnemosyne::probe probe(reinterpret_cast<void*>(&depth));
+  ASSERT_TRUE(probe.attach());
+
+  EXPECT_EQ(10, call_depth(10));
+
+  // calls nested deeper than the stack of timed calls are only counted
+  EXPECT_EQ(100, call_depth(100));
+
+  mnemosyne::probe::statistics statistics = probe.collect();
+  EXPECT_EQ(11 + 101, statistics.calls);
+  EXPECT_EQ(11 + 64, statistics.timed);
+  EXPECT_EQ(statistics.timed, sum(statistics.histogram));
+  EXPECT_TRUE(probe.detach());
+}
+
+TEST(probe_unittest, test_probe_registers) {
+  mnemosyne::probe probe(reinterpret_cast<void*>(&blend));
+  ASSERT_TRUE(probe.attach());
+
+  // arguments and the return value pass through the thunks untouched
+  EXPECT_DOUBLE_EQ(7.5, call_blend(1.5, 3.0, 3));
+  EXPECT_EQ(1, probe.collect().timed);
+}
+
+TEST(probe_unittest, test_probe_tail_calls) {
+  mnemosyne::probe outer_probe(reinterpret_cast<void*>(&outer));
+  mnemosyne::probe leaf_probe(reinterpret_cast<void*>(&leaf));
+  ASSERT_TRUE(outer_probe.attach());
+  ASSERT_TRUE(leaf_probe.attach());
+
+  for (int32_t n = 0; n < 10; ++n) {
+    EXPECT_EQ(2 * n + 1, call_outer(n));
+  }
+
+  // a leaf entered by a jump is counted, its time is part of outer
+  EXPECT_EQ(10, outer_probe.collect().calls);
+  EXPECT_EQ(10, outer_probe.collect().timed);
+  EXPECT_EQ(10, leaf_probe.collect().calls);
+
+  EXPECT_TRUE(leaf_probe.detach());
+  EXPECT_TRUE(outer_probe.detach());
+}
+#endif
@@ -0,0 +1,107 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <unistd.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+struct telemetry {
+  uint32_t health;
+  uint8_t padding[200];
+  float speed;
+  double position[3];
+};
+}  // namespace
+
+TEST(read_plan_unittest, test_read_plan_execute) {
+  telemetry t = {100, {0}, 2.5f, {1.0, 2.0, 3.0}};
+  uint32_t far_value = 0xdeadbeef;
+
+  uint32_t health = 0;
+  float speed = 0;
+  double position[3] = {0, 0, 0};
+  uint32_t far_copy = 0;
+  uint32_t invalid = 0x90909090;
+
+  mnemosyne::read_plan plan;
+  EXPECT_EQ(0, plan.add(reinterpret_cast<uintptr_t>(&t.speed), &speed));
+  EXPECT_EQ(1, plan.add(reinterpret_cast<uintptr_t>(&t.health), &health));
+  EXPECT_EQ(2, plan.add(reinterpret_cast<uintptr_t>(&t.position), position,
+                        sizeof(position)));
+  EXPECT_EQ(3, plan.add(reinterpret_cast<uintptr_t>(&far_value), &far_copy));
+  EXPECT_EQ(4, plan.add(0x10, &invalid));
+  EXPECT_EQ(5, plan.size());
+
+  EXPECT_EQ(4, plan.execute());
+  EXPECT_EQ(100, health);
+  EXPECT_EQ(2.5f, speed);
+  EXPECT_EQ(3.0, position[2]);
+  EXPECT_EQ(0xdeadbeef, far_copy);
+  EXPECT_TRUE(plan.succeeded(0));
+  EXPECT_FALSE(plan.succeeded(4));
+
+  // the same plan picks up new values on the next tick
+  t.health = 99;
+  t.position[0] = -1.0;
+  far_value = 0x12345678;
+
+  EXPECT_EQ(4, plan.execute());
+  EXPECT_EQ(99, health);
+  EXPECT_EQ(-1.0, position[0]);
+  EXPECT_EQ(0x12345678, far_copy);
+
+  plan.clear();
+  EXPECT_EQ(0, plan.size());
+  EXPECT_EQ(0, plan.execute());
+}
+
+TEST(read_plan_unittest, test_read_plan_overlapping_reads) {
+  uint8_t bytes[] = {0x11, 0x22, 0x33, 0x44, 0x55, 0x66};
+  uint32_t low = 0;
+  uint16_t middle = 0;
+  uint32_t high = 0;
+
+  mnemosyne::read_plan plan(0);
+  plan.add(reinterpret_cast<uintptr_t>(bytes), &low);
+  plan.add(reinterpret_cast<uintptr_t>(bytes + 1), &middle);
+  plan.add(reinterpret_cast<uintptr_t>(bytes + 2), &high);
+
+  EXPECT_EQ(3, plan.execute());
+  EXPECT_EQ(0x44332211, low);
+  EXPECT_EQ(0x3322, middle);
+  EXPECT_EQ(0x66554433, high);
+}
+
+TEST(read_plan_unittest, test_read_plan_remote_source) {
+#ifdef _WIN32
+  mnemosyne::remote_source source(GetCurrentProcessId());
+#else
+  mnemosyne::remote_source source(static_cast<uint32_t>(getpid()));
+#endif
+  ASSERT_TRUE(source.attached());
+
+  telemetry t = {100, {0}, 2.5f, {1.0, 2.0, 3.0}};
+  uint32_t health = 0;
+  double z = 0;
+  uint32_t invalid = 0;
+
+  mnemosyne::read_plan plan(source);
+  plan.add(reinterpret_cast<uintptr_t>(&t.health), &health);
+  plan.add(0x10, &invalid);
+  plan.add(reinterpret_cast<uintptr_t>(&t.position[2]), &z);
+
+  EXPECT_EQ(2, plan.execute());
+  EXPECT_EQ(100, health);
+  EXPECT_EQ(3.0, z);
+  EXPECT_FALSE(plan.succeeded(1));
+}
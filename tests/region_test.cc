@@ -0,0 +1,108 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+const size_t page_size = 0x1000;
+
+uint8_t* allocate_pages(size_t count) {
+#ifdef _WIN32
+  return static_cast<uint8_t*>(VirtualAlloc(
+      nullptr, count * page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+  return static_cast<uint8_t*>(mmap(nullptr, count * page_size,
+                                    PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+}
+
+void protect_page(uint8_t* page, bool readable) {
+#ifdef _WIN32
+  DWORD protect = 0;
+  VirtualProtect(page, page_size, readable ? PAGE_READONLY : PAGE_NOACCESS,
+                 &protect);
+#else
+  mprotect(page, page_size, readable ? PROT_READ : PROT_NONE);
+#endif
+}
+
+void free_pages(uint8_t* pages, size_t count) {
+#ifdef _WIN32
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  munmap(pages, count * page_size);
+#endif
+}
+}  // namespace
+
+TEST(region_unittest, test_regions_readable) {
+  uint8_t* pages = allocate_pages(3);
+  uintptr_t base = reinterpret_cast<uintptr_t>(pages);
+  protect_page(pages + page_size, false);
+
+  auto regions = mnemosyne::regions::readable(base, 3 * page_size);
+
+  ASSERT_EQ(2, regions.size());
+  EXPECT_EQ(base, regions.at(0).start);
+  EXPECT_EQ(page_size, regions.at(0).size);
+  EXPECT_TRUE(regions.at(0).writable);
+  EXPECT_EQ(base + 2 * page_size, regions.at(1).start);
+  EXPECT_EQ(page_size, regions.at(1).size);
+
+  free_pages(pages, 3);
+}
+
+TEST(region_unittest, test_regions_module_range) {
+  static uint32_t in_module = 0;
+  uintptr_t address = reinterpret_cast<uintptr_t>(&in_module);
+
+  auto range = mnemosyne::regions::module_range("");
+
+  EXPECT_LE(range.start, address);
+  EXPECT_GT(range.start + range.size, address);
+  EXPECT_EQ(0, mnemosyne::regions::module_range("not_loaded_module").size);
+}
+
+TEST(region_unittest, test_pattern_match_skips_unreadable_pages) {
+  uint8_t* pages = allocate_pages(3);
+  const uint8_t needle[] = {0xde, 0xad, 0xbe, 0xef, 0x13, 0x37};
+  std::copy(needle, needle + sizeof(needle), pages + 2 * page_size + 16);
+  protect_page(pages + page_size, false);
+
+  mnemosyne::pattern_match match("de ad ?? ef 13 37", pages, 3 * page_size);
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + 2 * page_size + 16),
+            match.find_address());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + 2 * page_size + 16),
+            match.find_address_parallel());
+  EXPECT_EQ(1, match.find_all().size());
+
+  free_pages(pages, 3);
+}
+
+TEST(region_unittest, test_pattern_match_across_adjacent_regions) {
+  uint8_t* pages = allocate_pages(2);
+  const uint8_t needle[] = {0xde, 0xad, 0xbe, 0xef, 0x13, 0x37};
+  std::copy(needle, needle + sizeof(needle), pages + page_size - 3);
+
+  // read write page followed by a read only page, the match spans both
+  protect_page(pages + page_size, true);
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(pages + page_size - 3),
+            mnemosyne::pattern_match("de ad be ef 13 37", pages, 2 * page_size)
+                .find_address());
+
+  free_pages(pages, 2);
+}
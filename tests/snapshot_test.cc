@@ -0,0 +1,221 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+namespace {
+uint8_t* allocate_pages(size_t size) {
+#ifdef _WIN32
+  return static_cast<uint8_t*>(
+      VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+  return static_cast<uint8_t*>(mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+}
+
+void free_pages(uint8_t* pages, size_t size) {
+#ifdef _WIN32
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  munmap(pages, size);
+#endif
+}
+
+std::vector<std::pair<uintptr_t, size_t>> pairs(
+    const std::vector<mnemosyne::snapshot::range>& ranges) {
+  std::vector<std::pair<uintptr_t, size_t>> result;
+  for (const auto& r : ranges) {
+    result.emplace_back(r.start, r.size);
+  }
+
+  return result;
+}
+
+uintptr_t at(const uint8_t* pages, size_t offset) {
+  return reinterpret_cast<uintptr_t>(pages + offset);
+}
+
+// a copy of the file with the 64 bit field at offset replaced
+bool load_patched(const std::string& path, size_t offset, uint64_t value) {
+  std::ifstream in(path, std::ios::binary);
+  std::string bytes((std::istreambuf_iterator<char>(in)),
+                    std::istreambuf_iterator<char>());
+  memcpy(&bytes[offset], &value, sizeof(value));
+
+  const std::string patched = path + ".patched";
+  std::ofstream(patched, std::ios::binary | std::ios::trunc) << bytes;
+  const bool loaded = mnemosyne::snapshot_file(patched).loaded();
+  std::remove(patched.c_str());
+
+  return loaded;
+}
+}  // namespace
+
+TEST(snapshot_unittest, test_snapshot_diff_live) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  uint8_t* pages = allocate_pages(4 * page_size);
+  for (size_t n = 0; n < 4 * page_size; ++n) {
+    pages[n] = static_cast<uint8_t>(n * 7);
+  }
+
+  mnemosyne::snapshot before(reinterpret_cast<uintptr_t>(pages),
+                             4 * page_size);
+  EXPECT_EQ(4 * page_size, before.size());
+  EXPECT_TRUE(before.diff().empty());
+
+  pages[5] ^= 0xff;
+  pages[6] ^= 0xff;
+  pages[page_size + 100] ^= 0xff;
+  // a run crossing into the next page is reported as one range
+  pages[3 * page_size - 1] ^= 0xff;
+  pages[3 * page_size] ^= 0xff;
+
+  std::vector<std::pair<uintptr_t, size_t>> expected = {
+      {at(pages, 5), 2},
+      {at(pages, page_size + 100), 1},
+      {at(pages, 3 * page_size - 1), 2}};
+  EXPECT_EQ(expected, pairs(before.diff()));
+
+  uint8_t old = 0;
+  EXPECT_TRUE(before.read(at(pages, 5), &old, 1));
+  EXPECT_EQ(5 * 7, old);
+
+  uint16_t across = 0;
+  EXPECT_TRUE(before.read(at(pages, page_size - 1), &across, 2));
+  EXPECT_FALSE(before.read(at(pages, 4 * page_size - 1), &across, 2));
+
+  // a page that can not be read any more counts as changed
+  EXPECT_TRUE(mnemosyne::platform::protect(pages + page_size, page_size,
+                                           false, false, false));
+  expected = {{at(pages, 5), 2},
+              {at(pages, page_size), page_size},
+              {at(pages, 3 * page_size - 1), 2}};
+  EXPECT_EQ(expected, pairs(before.diff()));
+
+  free_pages(pages, 4 * page_size);
+}
+
+TEST(snapshot_unittest, test_snapshot_diff_snapshots) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  uint8_t* pages = allocate_pages(3 * page_size);
+  memset(pages, 0x11, 3 * page_size);
+
+  mnemosyne::snapshot first(
+      {{reinterpret_cast<uintptr_t>(pages), 2 * page_size, true, true,
+        false}});
+
+  pages[page_size + 64] = 0x22;
+  mnemosyne::snapshot second(reinterpret_cast<uintptr_t>(pages),
+                             3 * page_size);
+
+  // the third page is only in the second snapshot
+  std::vector<std::pair<uintptr_t, size_t>> expected = {
+      {at(pages, page_size + 64), 1},
+      {at(pages, 2 * page_size), page_size}};
+  EXPECT_EQ(expected, pairs(first.diff(second)));
+  EXPECT_TRUE(second.diff(second).empty());
+
+  free_pages(pages, 3 * page_size);
+}
+
+TEST(snapshot_unittest, test_snapshot_file) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  uint8_t* pages = allocate_pages(5 * page_size);
+  memset(pages, 0x33, page_size);
+  memset(pages + 2 * page_size, 0x44, page_size);
+  memset(pages + 4 * page_size, 0x55, page_size);
+
+  std::string path = testing::TempDir() + "mnemosyne_snapshot.bin";
+  EXPECT_TRUE(mnemosyne::snapshot(reinterpret_cast<uintptr_t>(pages),
+                                  5 * page_size)
+                  .save(path));
+
+  // the file keeps the bytes at the time of the snapshot
+  memset(pages, 0, 5 * page_size);
+
+  mnemosyne::snapshot_file file(path);
+  ASSERT_TRUE(file.loaded());
+  EXPECT_EQ(5, file.captured_pages());
+  // the two zero pages are stored once
+  EXPECT_EQ(4, file.stored_pages());
+
+  uint32_t value = 0;
+  EXPECT_TRUE(file.read(&value, at(pages, 2 * page_size - 2), sizeof(value)));
+  EXPECT_EQ(0x44440000, value);
+  EXPECT_FALSE(file.read(&value, at(pages, 5 * page_size - 2), sizeof(value)));
+  EXPECT_FALSE(file.write(at(pages, 0), &value, sizeof(value)));
+
+  EXPECT_NE(nullptr, file.in_place(at(pages, 0), 3 * page_size));
+  EXPECT_EQ(nullptr, file.in_place(at(pages, 2 * page_size), 2 * page_size));
+
+  std::vector<mnemosyne::memory_region> regions =
+      file.readable(0, UINTPTR_MAX);
+  ASSERT_EQ(1, regions.size());
+  EXPECT_EQ(at(pages, 0), regions.front().start);
+  EXPECT_EQ(5 * page_size, regions.front().size);
+
+  // scanned in place across the first pages, copied across the repeated one
+  mnemosyne::pattern_match in_place("33 33 00 00", file, at(pages, 0),
+                                    5 * page_size);
+  EXPECT_EQ(at(pages, page_size - 2), in_place.find_address());
+
+  mnemosyne::pattern_match copied("44 44 00 00", file, at(pages, 0),
+                                  5 * page_size);
+  EXPECT_EQ(std::vector<uintptr_t>({at(pages, 3 * page_size - 2)}),
+            copied.find_all());
+
+  mnemosyne::address remote(file, at(pages, 4 * page_size));
+  EXPECT_EQ(0x55555555, remote.read<uint32_t>());
+
+  free_pages(pages, 5 * page_size);
+  std::remove(path.c_str());
+
+  EXPECT_FALSE(mnemosyne::snapshot_file(path).loaded());
+}
+
+TEST(snapshot_unittest, test_snapshot_file_regions) {
+  const size_t page_size = mnemosyne::platform::page_size();
+  uint8_t* pages = allocate_pages(3 * page_size);
+  memset(pages, 0x11, 3 * page_size);
+
+  // two regions of one page with a page between them
+  std::string path = testing::TempDir() + "mnemosyne_regions.bin";
+  EXPECT_TRUE(mnemosyne::snapshot(
+                  {{at(pages, 0), page_size, true, true, false},
+                   {at(pages, 2 * page_size), page_size, true, true, false}})
+                  .save(path));
+  free_pages(pages, 3 * page_size);
+
+  // the header is followed by the regions as start, pages and first
+  const size_t first_region = 48;
+  const size_t second_region = first_region + 24;
+  EXPECT_TRUE(load_patched(path, second_region, at(pages, 2 * page_size)));
+
+  // regions out of order or overlapping
+  EXPECT_FALSE(load_patched(path, second_region, at(pages, 0)));
+  EXPECT_FALSE(load_patched(path, second_region, at(pages, page_size / 2)));
+
+  // pages past the page index, also through an overflow
+  EXPECT_FALSE(load_patched(path, second_region + 8, 2));
+  EXPECT_FALSE(load_patched(path, second_region + 16, UINT64_MAX));
+  EXPECT_FALSE(load_patched(path, first_region + 8, UINT64_MAX));
+
+  std::remove(path.c_str());
+}
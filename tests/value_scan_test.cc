@@ -0,0 +1,127 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+TEST(value_scan_unittest, test_value_scan_narrowing) {
+  std::vector<uint32_t> memory(0x40000, 0);
+  const size_t indices[] = {3, 0x1000, 0x12345, 0x3ffff};
+
+  for (size_t index : indices) {
+    memory.at(index) = 100;
+  }
+
+  mnemosyne::value_scan<uint32_t> scan(memory.data(),
+                                       memory.size() * sizeof(uint32_t));
+  EXPECT_EQ(4, scan.first_scan(100));
+
+  std::vector<uintptr_t> expected;
+  for (size_t index : indices) {
+    expected.push_back(reinterpret_cast<uintptr_t>(&memory.at(index)));
+  }
+  EXPECT_EQ(expected, scan.addresses());
+
+  using compare = mnemosyne::value_scan<uint32_t>::compare;
+
+  memory.at(3) = 90;
+  memory.at(0x1000) = 110;
+  EXPECT_EQ(2, scan.next_scan(compare::changed));
+
+  // the comparison is against the value at the last scan
+  memory.at(0x1000) = 120;
+  EXPECT_EQ(1, scan.next_scan(compare::increased));
+  EXPECT_EQ(std::vector<uintptr_t>({expected.at(1)}), scan.addresses());
+
+  EXPECT_EQ(1, scan.next_scan(compare::unchanged));
+  memory.at(0x1000) = 105;
+  EXPECT_EQ(1, scan.next_scan(compare::decreased));
+  EXPECT_EQ(0, scan.next_scan(compare::equals, 106));
+}
+
+TEST(value_scan_unittest, test_value_scan_dense) {
+  std::vector<uint8_t> memory(0x30000, 7);
+
+  mnemosyne::value_scan<uint8_t> scan(memory.data(), memory.size());
+  EXPECT_EQ(memory.size(), scan.first_scan(7));
+
+  for (size_t n = 0; n < memory.size(); n += 2) {
+    memory.at(n) = 8;
+  }
+
+  EXPECT_EQ(memory.size() / 2,
+            scan.next_scan(mnemosyne::value_scan<uint8_t>::compare::equals, 8));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(memory.data()),
+            scan.addresses(1).front());
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&memory.back()) - 1,
+            scan.addresses().back());
+}
+
+TEST(value_scan_unittest, test_value_scan_unaligned) {
+  std::vector<uint8_t> memory(0x100, 0);
+  const uint64_t value = 0x1122334455667788;
+  memcpy(memory.data() + 5, &value, sizeof(value));
+
+  mnemosyne::value_scan<uint64_t> aligned(memory.data(), memory.size());
+  EXPECT_EQ(0, aligned.first_scan(value));
+
+  mnemosyne::value_scan<uint64_t> unaligned(memory.data(), memory.size(),
+                                            false);
+  EXPECT_EQ(1, unaligned.first_scan(value));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(memory.data() + 5),
+            unaligned.addresses().front());
+}
+
+TEST(value_scan_unittest, test_value_scan_float) {
+  std::vector<float> memory(0x1000, 0.0f);
+  memory.at(0x123) = 1.5f;
+  memory.at(0x456) = 1.5f;
+
+  mnemosyne::value_scan<float> scan(memory.data(),
+                                    memory.size() * sizeof(float));
+  EXPECT_EQ(2, scan.first_scan(1.5f));
+
+  memory.at(0x456) = 2.75f;
+  EXPECT_EQ(1, scan.next_scan(mnemosyne::value_scan<float>::compare::equals,
+                              2.75f));
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&memory.at(0x456)),
+            scan.addresses().front());
+}
+
+TEST(value_scan_unittest, test_value_scan_rescan) {
+  std::vector<uint32_t> memory(0x40000, 0);
+  for (size_t n = 0; n < memory.size(); n += 0x1001) {
+    memory.at(n) = 100;
+  }
+
+  uintptr_t base = reinterpret_cast<uintptr_t>(memory.data());
+  size_t size = memory.size() * sizeof(uint32_t);
+  mnemosyne::value_scan<uint32_t> scan(memory.data(), size);
+  mnemosyne::dirty_pages dirty(base, size, false);
+
+  scan.first_scan(100);
+  dirty.collect();
+
+  memory.at(0x1001) = 7;
+  memory.at(0x1002) = 100;
+  memory.at(0x2fff0) = 100;
+  // denser than a block holds as an array
+  std::fill(memory.begin() + 0x38000, memory.begin() + 0x38400, 100);
+
+  size_t found = scan.rescan(100, dirty.collect());
+
+  mnemosyne::value_scan<uint32_t> fresh(memory.data(), size);
+  EXPECT_EQ(fresh.first_scan(100), found);
+  EXPECT_EQ(fresh.addresses(), scan.addresses());
+
+  memory.at(0x38010) = 5;
+  scan.rescan(100, dirty.collect());
+  EXPECT_EQ(fresh.first_scan(100), scan.size());
+  EXPECT_EQ(fresh.addresses(), scan.addresses());
+}
@@ -0,0 +1,178 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <thread>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || \
+    defined(_M_IX86)
+namespace {
+struct player {
+  uint32_t id;
+  uint32_t health;
+  uint32_t armor;
+  uint32_t score;
+};
+
+player* allocate_player() {
+#ifdef _WIN32
+  return static_cast<player*>(VirtualAlloc(
+      nullptr, 0x1000, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+  return static_cast<player*>(mmap(nullptr, 0x1000, PROT_READ | PROT_WRITE,
+                                   MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+}
+
+void free_player(player* memory) {
+#ifdef _WIN32
+  VirtualFree(memory, 0, MEM_RELEASE);
+#else
+  munmap(memory, 0x1000);
+#endif
+}
+}  // namespace
+
+TEST(watch_unittest, test_watch_logs_writes_in_range) {
+  player* memory = allocate_player();
+  volatile player* target = memory;
+
+  mnemosyne::write_watch watch(&memory->health, 2 * sizeof(uint32_t));
+  ASSERT_TRUE(watch.arm());
+  EXPECT_TRUE(watch.armed());
+
+  target->health = 75;
+  // the rest of the page is stepped over without being logged
+  target->id = 7;
+  target->score = 1000;
+  target->armor = 20;
+
+  std::vector<mnemosyne::write_hit> hits;
+  EXPECT_EQ(2, watch.drain(hits));
+  ASSERT_EQ(2, hits.size());
+
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&memory->health), hits.at(0).address);
+  EXPECT_EQ(1, hits.at(0).size);
+  EXPECT_NE(0, hits.at(0).instruction);
+  EXPECT_NE(0, hits.at(0).thread);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(&memory->armor), hits.at(1).address);
+
+  EXPECT_EQ(0, watch.drain(hits));
+  EXPECT_EQ(0, watch.dropped());
+
+  watch.disarm();
+  EXPECT_FALSE(watch.armed());
+
+  mnemosyne::memory_region region = {0, 0, false, false, false};
+  EXPECT_TRUE(
+      mnemosyne::platform::query(reinterpret_cast<uintptr_t>(memory), region));
+  EXPECT_TRUE(region.writable);
+
+  target->health = 0x12345678;
+  EXPECT_EQ(0, watch.drain(hits));
+
+  EXPECT_EQ(7, memory->id);
+  EXPECT_EQ(0x12345678, memory->health);
+  EXPECT_EQ(20, memory->armor);
+  EXPECT_EQ(1000, memory->score);
+
+  free_player(memory);
+}
+
+TEST(watch_unittest, test_watch_size_from_changed_bytes) {
+  player* memory = allocate_player();
+  volatile player* target = memory;
+
+  mnemosyne::write_watch watch(&memory->health, sizeof(uint32_t));
+  ASSERT_TRUE(watch.arm());
+
+  target->health = 0x01020304;
+  target->health = 0x01020304;
+
+  std::vector<mnemosyne::write_hit> hits;
+  ASSERT_EQ(2, watch.drain(hits));
+  EXPECT_EQ(4, hits.at(0).size);
+  // nothing changed on the second write
+  EXPECT_EQ(0, hits.at(1).size);
+
+  free_player(memory);
+}
+
+TEST(watch_unittest, test_watch_full_ring_drops) {
+  player* memory = allocate_player();
+  volatile player* target = memory;
+
+  mnemosyne::write_watch watch(&memory->score, sizeof(uint32_t), 3);
+  ASSERT_TRUE(watch.arm());
+
+  // the capacity is rounded up to 4
+  for (uint32_t n = 1; n <= 6; ++n) {
+    target->score = n;
+  }
+
+  std::vector<mnemosyne::write_hit> hits;
+  EXPECT_EQ(4, watch.drain(hits));
+  EXPECT_EQ(2, watch.dropped());
+  EXPECT_EQ(6, memory->score);
+
+  target->score = 7;
+  EXPECT_EQ(1, watch.drain(hits));
+
+  watch.disarm();
+  free_player(memory);
+}
+
+TEST(watch_unittest, test_watch_overlapping_pages) {
+  player* memory = allocate_player();
+
+  mnemosyne::write_watch first(&memory->id, sizeof(uint32_t));
+  mnemosyne::write_watch second(&memory->score, sizeof(uint32_t));
+
+  ASSERT_TRUE(first.arm());
+  EXPECT_FALSE(second.arm());
+
+  first.disarm();
+  EXPECT_TRUE(second.arm());
+  second.disarm();
+
+  free_player(memory);
+}
+
+TEST(watch_unittest, test_watch_disarm_under_writes) {
+  player* memory = allocate_player();
+  volatile player* target = memory;
+  std::atomic<bool> done(false);
+
+  // faults racing with disarm must neither step nor reach a freed watch
+  std::thread writer([&]() {
+    while (!done) {
+      ++target->health;
+    }
+  });
+
+  for (size_t n = 0; n < 200; ++n) {
+    mnemosyne::write_watch watch(&memory->health, sizeof(uint32_t));
+    ASSERT_TRUE(watch.arm());
+    std::this_thread::yield();
+  }
+
+  done = true;
+  writer.join();
+  EXPECT_LT(0, target->health);
+
+  free_player(memory);
+}
+#endif
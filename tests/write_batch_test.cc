@@ -0,0 +1,152 @@
+#include "../mnemosyne.h"
+
+#include <gtest/gtest.h>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#endif
+
+#ifdef _WIN64
+#pragma comment(lib, "mnemosyne.lib")
+#pragma comment(lib, "detours64.lib")
+#elif _WIN32
+#pragma comment(lib, "mnemosyne32.lib")
+#pragma comment(lib, "detours.lib")
+#endif
+
+TEST(write_batch_unittest, test_write_batch_apply) {
+  uint32_t a = 0xdeadbeef;
+  uint64_t b = 0x1122334455667788;
+  uint8_t c[3] = {0x11, 0x22, 0x33};
+
+  mnemosyne::write_batch batch;
+  EXPECT_EQ(0, batch.add(&a, std::vector<uint8_t>{0x78, 0x56, 0x34, 0x12}));
+  EXPECT_EQ(1, batch.add(&b, "\xef\xbe\xad\xde", 4));
+  EXPECT_EQ(2, batch.add(c + 1, std::vector<uint8_t>{0x90, 0x90}));
+  EXPECT_EQ(3, batch.add(reinterpret_cast<void*>(0x10), "\x90", 1));
+  EXPECT_EQ(4, batch.size());
+
+  std::vector<bool> expected = {true, true, true, false};
+  EXPECT_EQ(expected, batch.apply());
+
+  EXPECT_EQ(0x12345678, a);
+  EXPECT_EQ(0x11223344deadbeef, b);
+  EXPECT_EQ(0x11, c[0]);
+  EXPECT_EQ(0x90, c[1]);
+  EXPECT_EQ(0x90, c[2]);
+
+  batch.clear();
+  EXPECT_EQ(0, batch.size());
+  EXPECT_TRUE(batch.apply().empty());
+}
+
+TEST(write_batch_unittest, test_write_batch_read_only_pages) {
+  const size_t page_size = mnemosyne::platform::page_size();
+#ifdef _WIN32
+  auto pages = static_cast<uint8_t*>(VirtualAlloc(
+      nullptr, 3 * page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READONLY));
+#else
+  auto pages = static_cast<uint8_t*>(mmap(nullptr, 3 * page_size, PROT_READ,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+#endif
+
+  mnemosyne::write_batch batch;
+  for (size_t n = 0; n < 3 * page_size; n += 256) {
+    batch.add(pages + n, std::vector<uint8_t>{0xcc, 0xcc});
+  }
+
+  std::vector<bool> results = batch.apply();
+  EXPECT_EQ(3 * page_size / 256, results.size());
+  for (size_t n = 0; n < results.size(); ++n) {
+    EXPECT_TRUE(results.at(n));
+    EXPECT_EQ(0xcc, pages[n * 256]);
+    EXPECT_EQ(0xcc, pages[n * 256 + 1]);
+  }
+
+  mnemosyne::memory_region region = {0, 0, false, false, false};
+  EXPECT_TRUE(mnemosyne::platform::query(
+      reinterpret_cast<uintptr_t>(pages + page_size), region));
+  EXPECT_FALSE(region.writable);
+
+#ifdef _WIN32
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  munmap(pages, 3 * page_size);
+#endif
+}
+
+TEST(write_batch_unittest, test_write_batch_mixed_protections) {
+  const size_t page_size = mnemosyne::platform::page_size();
+#ifdef _WIN32
+  auto pages = static_cast<uint8_t*>(VirtualAlloc(
+      nullptr, 3 * page_size, MEM_COMMIT | MEM_RESERVE, PAGE_READONLY));
+  DWORD old = 0;
+  // a guard page between two read only ones is changed and put back alone
+  ASSERT_TRUE(VirtualProtect(pages + page_size, page_size,
+                             PAGE_READONLY | PAGE_GUARD, &old));
+#else
+  auto pages = static_cast<uint8_t*>(mmap(nullptr, 3 * page_size, PROT_READ,
+                                          MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+  ASSERT_TRUE(mnemosyne::platform::protect(pages + page_size, page_size, true,
+                                           false, true));
+#endif
+
+  mnemosyne::write_batch batch;
+  for (size_t n = 0; n < 3; ++n) {
+    batch.add(pages + n * page_size + 8, std::vector<uint8_t>{0xcc});
+  }
+
+  for (bool result : batch.apply()) {
+    EXPECT_TRUE(result);
+  }
+
+  for (size_t n = 0; n < 3; ++n) {
+    EXPECT_EQ(0xcc, pages[n * page_size + 8]);
+  }
+
+  // every page gets its own protection back
+#ifdef _WIN32
+  for (size_t n = 0; n < 3; ++n) {
+    MEMORY_BASIC_INFORMATION mbi = {};
+    VirtualQuery(pages + n * page_size, &mbi, sizeof(mbi));
+    EXPECT_EQ(static_cast<DWORD>(n == 1 ? PAGE_READONLY | PAGE_GUARD
+                                        : PAGE_READONLY),
+              mbi.Protect);
+  }
+
+  VirtualFree(pages, 0, MEM_RELEASE);
+#else
+  for (size_t n = 0; n < 3; ++n) {
+    mnemosyne::memory_region region = {0, 0, false, false, false};
+    EXPECT_TRUE(mnemosyne::platform::query(
+        reinterpret_cast<uintptr_t>(pages + n * page_size), region));
+    EXPECT_FALSE(region.writable);
+    EXPECT_EQ(n == 1, region.executable);
+  }
+
+  munmap(pages, 3 * page_size);
+#endif
+}
+
+TEST(write_batch_unittest, test_write_batch_memory_edits) {
+  uint32_t n = 0xdeadbeef;
+  uint16_t m = 0xbaad;
+
+  mnemosyne::memory_patch patch(&n,
+                                std::vector<uint8_t>{0x78, 0x56, 0x34, 0x12});
+  mnemosyne::memory_data_edit<uint16_t> data_edit(&m, 0xf00d);
+
+  mnemosyne::write_batch batch;
+  EXPECT_EQ(0, patch.edit(batch));
+  EXPECT_EQ(1, data_edit.edit(batch));
+  batch.apply();
+  EXPECT_EQ(0x12345678, n);
+  EXPECT_EQ(0xf00d, m);
+
+  batch.clear();
+  patch.revert(batch);
+  data_edit.revert(batch);
+  batch.apply();
+  EXPECT_EQ(0xdeadbeef, n);
+  EXPECT_EQ(0xbaad, m);
+}